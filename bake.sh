@@ -23,3 +23,22 @@ else
 clang -fsanitize=undefined -g -O0 -L/usr/lib -lX11 -lXi -lXcursor -lGL -ldl -lm -lpthread ../main.c
 #  gcc -g -O0 ../main.c -Wall -Werror -lX11 -lXi -lXcursor -lGL -ldl -lm -lpthread
 fi
+
+# compile the blender meshes in meshes.json into build/meshes.bytes
+(cd .. && python3 mesh2flat.py) || exit 1
+
+# bake the palette and chunk meshes into build/assets.pack so startup doesn't have to
+cc -O2 -o pack ../pack.c -lm -lpthread || exit 1
+(cd .. && ./build/pack) || exit 1
+
+# ./bake.sh bench - headless, optimized; fails if anything regressed against bench_baseline.json
+if [[ $1 == 'bench' ]]; then
+  cc -O2 -o bench ../bench.c -lm -lpthread || exit 1
+  cd .. && ./build/bench > build/bench.json && python3 bench_compare.py build/bench.json bench_baseline.json
+fi
+
+# ./bake.sh emit - each geometry writer in a tight loop with no gpu, then a whole frame's worth
+if [[ $1 == 'emit' ]]; then
+  cc -O2 -o emitbench ../emitbench.c -lm -lpthread || exit 1
+  cd .. && ./build/emitbench
+fi
@@ -0,0 +1,473 @@
+/* headless benchmark: runs the sim and the geometry writers through named
+ * scenarios for a fixed number of ticks, printing the results as json.
+ *
+ * ./bake.sh bench builds this, runs it and checks the results against
+ * bench_baseline.json with bench_compare.py */
+#define HEADLESS
+#define SNAPSHOTS
+
+#include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
+/* the budgets are calloc'd; nothing else in the headless build allocates
+ * but stb_truetype, which is checked for below */
+static struct { size_t count, bytes; } bench_allocs;
+static void *bench_calloc(size_t n, size_t size) {
+    bench_allocs.count++, bench_allocs.bytes += n * size;
+    return calloc(n, size);
+}
+#define calloc(n, size) bench_calloc(n, size)
+
+#include "main.c"
+
+/* rasterizing a glyph would malloc behind the allocs count's back otherwise */
+#ifndef STBTT_malloc
+#error "stb_truetype has to allocate from the budgets, see STBTT_malloc in main.c"
+#endif
+
+#define BENCH_TICKS (600)
+
+typedef struct {
+    char *name;
+    void (*setup)(void);
+    void (*each_tick)(void); /* optional */
+} Scenario;
+
+/* map_reload copies what it's given into a block the next reload reuses,
+ * so the default map is kept aside as a pristine copy */
+static MapData bench_default_map;
+static int bench_map_changed;
+
+static float bench_randf(float min, float max) {
+    return min + (max - min) * ((float)rand() / (float)RAND_MAX);
+}
+
+static MapData bench_map_dup(MapData md) {
+    MapData dup = md;
+    dup.trees = calloc(sizeof(MapData_Tree), md.ntrees + 1);
+    dup.circles = calloc(sizeof(MapData_Circle), md.ncircles + 1);
+    memcpy(dup.trees, md.trees, sizeof(MapData_Tree) * md.ntrees);
+    memcpy(dup.circles, md.circles, sizeof(MapData_Circle) * md.ncircles);
+    return dup;
+}
+
+static void bench_use_map(MapData md) {
+    map_reload(md, NULL);
+    bench_map_changed = 1;
+}
+
+static void bench_reset(void) {
+    srand(1);
+    arena_reset(mem + Mem_Frame);
+    if (bench_map_changed) map_reload(bench_default_map, NULL);
+    bench_map_changed = 0;
+
+    memset(state.keys, 0, sizeof(state.keys));
+    memset(state.ui, 0, sizeof(*state.ui));
+    ui_init();
+    state.cam = vec2(0.0f, 0.0f);
+    state.zoom = GAME_SCALE;
+
+    world_init(state.world, &state.level);
+    memset(state.parts, 0, sizeof(*state.parts));
+}
+
+static void scenario_default(void) {
+    World *w = state.world;
+    struct { float x, y, radius; } pots[] = {
+        { 5.0f + 3.0f, 3.0f, 0.6f },
+        { 5.0f + 5.0f, 2.0f, 0.7f },
+        { 5.0f + 4.0f, 5.0f, 0.5f },
+    };
+    for (int i = 0; i < sizeof(pots) / sizeof(pots[0]); i++)
+        ent_spawn_pot(w, vec2(pots[i].x, pots[i].y), pots[i].radius);
+}
+
+/* a player beset by `npot` pots that are already after them */
+static void bench_waffle(World *w, int npot) {
+    w->player->pos = vec2(9.0f, 3.0f);
+    for (int i = 0; i < npot; i++) {
+        Vec2 at = add2(w->player->pos, mul2f(rads2(bench_randf(0.0f, M_PI*2.0f)), bench_randf(3.0f, 8.0f)));
+        ent_comp_set(w, ent_spawn_pot(w, at, bench_randf(0.4f, 0.7f)), EntComp_Aggroed, 1);
+    }
+}
+
+static void scenario_waffle(void) {
+    bench_waffle(state.world, 128);
+}
+
+/* as far out as the scroll wheel goes, over the middle of the map */
+static void scenario_zoomed_out(void) {
+    scenario_waffle();
+    state.zoom = GAME_SCALE * 8.0f;
+}
+static void zoomed_out_tick(void) {
+    state.cam = vec2(9.0f, 10.0f);
+}
+
+static void scenario_arrows(void) {
+    World *w = state.world;
+    w->player->pos = vec2(9.0f, 3.0f);
+    for (int i = 0; i < 16; i++)
+        ent_spawn_pot(w, add2(w->player->pos, mul2f(rads2(i / 16.0f * M_PI*2.0f), 6.0f)), 0.6f);
+    for (int i = 0; i < 512; i++) {
+        Vec2 dir = rads2(bench_randf(0.0f, M_PI*2.0f));
+        proj_spawn(w, add2(w->player->pos, dir), mul2f(dir, 0.13f), edx_from(w, w->player), EntMask_Enemy);
+    }
+}
+
+/* armed pots strewn far past the edges of the view, standing around */
+static void scenario_spread(void) {
+    World *w = state.world;
+    w->player->pos = vec2(9.0f, 3.0f);
+    for (int i = 0; i < 512; i++)
+        ent_spawn_pot(w, vec2(bench_randf(-80.0f, 80.0f), bench_randf(-80.0f, 80.0f)), 0.6f);
+}
+
+/* the pool nearly full, spread over a map much bigger than the view and all
+ * after the player, who walks a wide circle through them */
+static void scenario_populated(void) {
+    World *w = state.world;
+    for (int i = 0; i < 960; i++) {
+        Vec2 at = vec2(bench_randf(-96.0f, 96.0f), bench_randf(-96.0f, 96.0f));
+        ent_comp_set(w, ent_spawn_pot(w, at, 0.5f), EntComp_Aggroed, 1);
+    }
+}
+static void populated_tick(void) {
+    World *w = state.world;
+    w->input.move = rads2(w->tick / 120.0f);
+}
+
+static void scenario_dense_trees(void) {
+    static MapData_Tree trees[600];
+    static MapData_Circle circles[400];
+    MapData md = { .ntrees = 600, .trees = trees, .ncircles = 400, .circles = circles };
+    for (int i = 0; i < md.ntrees; i++)
+        md.trees[i] = (MapData_Tree) { bench_randf(-15.0f, 15.0f), bench_randf(-15.0f, 15.0f) };
+    for (int i = 0; i < md.ncircles; i++)
+        md.circles[i] = (MapData_Circle) {
+            bench_randf(-15.0f, 15.0f), bench_randf(-15.0f, 15.0f), bench_randf(0.3f, 1.0f)
+        };
+    bench_use_map(md);
+
+    for (int i = 0; i < 32; i++) {
+        Vec2 at = vec2(bench_randf(-12.0f, 12.0f), bench_randf(-12.0f, 12.0f));
+        ent_comp_set(state.world, ent_spawn_pot(state.world, at, 0.5f), EntComp_Aggroed, 1);
+    }
+}
+
+static void scenario_heavy_ui(void) {
+    scenario_default();
+    state.world->aimer.active = 1;
+
+    UiBox *parent = state.ui->boxes;
+    UI_SYSTEM(b) parent = b;
+    for (UiBox *b = parent + 1; (b - state.ui->boxes) < UI_BOX_COUNT; b++)
+        *b = (UiBox) {
+            .looks = ((b - state.ui->boxes) % 3) ? UiBoxLooks_Item : UiBoxLooks_Frame,
+            .pos = vec2(bench_randf(0.0f, 1000.0f), bench_randf(0.0f, 600.0f)),
+            .size = vec2(200.0f, 150.0f),
+            .item = EntItem_Sword + (b - state.ui->boxes) % 2,
+        };
+}
+static void heavy_ui_tick(void) {
+    World *w = state.world;
+    for (int i = 0; i < sizeof(w->dmg_lbls) / sizeof(w->dmg_lbls[0]); i++)
+        w->dmg_lbls[i] = (DmgLbl) {
+            .pos = vec2((i % 16) * 1.5f - 11.0f, (i / 16) * 1.7f - 6.0f),
+            .hp = i,
+            .tick = w->tick,
+        };
+}
+
+/* the pool kept about full by a steady rain of hits, with the few ents
+ * of the default scenario around for comparison */
+static void scenario_particles(void) {
+    scenario_default();
+    state.world->parts = state.parts;
+}
+static void particles_tick(void) {
+    for (int i = 0; i < 40; i++) {
+        Vec2 at = vec2(bench_randf(-10.0f, 10.0f), bench_randf(-6.0f, 6.0f));
+        parts_burst(state.parts, at, vec2(0.0f, 0.0f), 14, 0.08f, 0.08f, Color_Brown);
+    }
+}
+
+static Scenario scenarios[] = {
+    { "default",     scenario_default                    },
+    { "waffle_128",  scenario_waffle                     },
+    { "arrows_512",  scenario_arrows                     },
+    { "dense_trees", scenario_dense_trees                },
+    { "heavy_ui",    scenario_heavy_ui,    heavy_ui_tick },
+    { "zoomed_out",  scenario_zoomed_out,  zoomed_out_tick },
+    { "particles_16k", scenario_particles, particles_tick  },
+    { "spread_512",  scenario_spread                     },
+    { "populated_960", scenario_populated, populated_tick },
+};
+
+static int u64_cmp(const void *a, const void *b) {
+    uint64_t l = *(uint64_t *)a, r = *(uint64_t *)b;
+    return (l > r) - (l < r);
+}
+static double pct_us(uint64_t *sorted, int n, float pct) {
+    return stm_us(sorted[(int)((n - 1) * pct)]);
+}
+
+static void bench_run(Scenario *sc, int first) {
+    static uint64_t tick_t[BENCH_TICKS], emit_t[BENCH_TICKS];
+    bench_reset();
+    sc->setup();
+
+    uint64_t static_start = stm_now();
+    map_chunks_rebuild_all();
+    double static_us = stm_us(stm_since(static_start));
+    size_t static_idxs = 0;
+    for (MapChunk *c = state.chunks; (c - state.chunks) < state.nchunk; c++)
+        static_idxs += c->nidx;
+
+    int verts_max = 0, idxs_max = 0;
+    size_t allocs = bench_allocs.count, alloc_bytes = bench_allocs.bytes;
+    for (int t = 0; t < BENCH_TICKS; t++) {
+        if (sc->each_tick) sc->each_tick();
+
+        uint64_t start = stm_now();
+        tick(state.world);
+        uint64_t ticked = stm_now();
+        state.cam = lerp2(state.cam, add2(state.world->player->pos, vec2(0.0f, 0.5f)), 0.05f);
+
+        GeoWtr wtr = geo_wtr(&state.dyn_geo);
+        write_world(&wtr, state.world);
+        write_hud(&wtr, state.world);
+        geo_wtr_flush(&wtr);
+        glyphs_flush(mem + Mem_Frame);
+        if (state.world->parts) {
+            GeoWtr part_wtr = geo_wtr(&state.part_geo);
+            write_parts(&part_wtr, state.world->parts);
+            geo_wtr_flush(&part_wtr);
+        }
+        sg_commit();
+
+        tick_t[t] = stm_diff(ticked, start);
+        emit_t[t] = stm_since(ticked);
+        verts_max = fmaxf(verts_max, wtr.vert - state.dyn_geo.verts);
+        idxs_max  = fmaxf(idxs_max,  wtr.idx  - state.dyn_geo.idxs);
+        if (TRACING) trace_drain();
+    }
+    allocs = bench_allocs.count - allocs;
+    alloc_bytes = bench_allocs.bytes - alloc_bytes;
+
+    int live = 0;
+    SYSTEM(state.world, e) live++;
+    int live_parts = state.world->parts ? state.world->parts->count : 0;
+    int live_projs = state.world->nproj;
+
+    /* what frame() would draw of the map from where the camera ended up */
+    MapLod lod = map_lod_pick();
+    size_t map_idxs_drawn = 0;
+    for (MapChunk *c = state.chunks; (c - state.chunks) < state.nchunk; c++)
+        if (map_chunk_visible(c)) map_idxs_drawn += c->lod_nidx[lod];
+
+    qsort(tick_t, BENCH_TICKS, sizeof(uint64_t), u64_cmp);
+    qsort(emit_t, BENCH_TICKS, sizeof(uint64_t), u64_cmp);
+    printf("%s    \"%s\": {\n", first ? "" : ",\n", sc->name);
+    printf("      \"tick_p50_us\": %.2f,\n",   pct_us(tick_t, BENCH_TICKS, 0.50f));
+    printf("      \"tick_p99_us\": %.2f,\n",   pct_us(tick_t, BENCH_TICKS, 0.99f));
+    printf("      \"emit_p50_us\": %.2f,\n",   pct_us(emit_t, BENCH_TICKS, 0.50f));
+    printf("      \"emit_p99_us\": %.2f,\n",   pct_us(emit_t, BENCH_TICKS, 0.99f));
+    printf("      \"static_emit_us\": %.2f,\n", static_us);
+    printf("      \"static_idxs\": %zu,\n",     static_idxs);
+    printf("      \"map_idxs_drawn\": %zu,\n",  map_idxs_drawn);
+    printf("      \"dyn_verts_max\": %d,\n",    verts_max);
+    printf("      \"dyn_idxs_max\": %d,\n",     idxs_max);
+    printf("      \"live_ents\": %d,\n",        live);
+    printf("      \"live_parts\": %d,\n",       live_parts);
+    printf("      \"live_projs\": %d,\n",       live_projs);
+    printf("      \"allocs\": %zu,\n",          allocs);
+    printf("      \"alloc_bytes\": %zu\n",      alloc_bytes);
+    printf("    }");
+}
+
+/* many worlds in one process: BENCH_WORLDS small fights on the same level,
+ * stepped by 1..nproc threads that each take every nth world */
+#define BENCH_WORLDS (128)
+#define BENCH_WORLD_TICKS (60)
+#define BENCH_WORLD_POTS (24)
+
+typedef struct { World *worlds; int first, stride; } BenchWorker;
+
+static void *bench_worker(void *arg) {
+    BenchWorker *bw = arg;
+    for (int t = 0; t < BENCH_WORLD_TICKS; t++)
+        for (int i = bw->first; i < BENCH_WORLDS; i += bw->stride)
+            tick(bw->worlds + i);
+    return NULL;
+}
+
+static void bench_worlds(void) {
+    World *worlds = calloc(sizeof(World), BENCH_WORLDS);
+    int ncore = sysconf(_SC_NPROCESSORS_ONLN);
+    if (ncore < 1) ncore = 1;
+
+    printf("  \"worlds\": {\n");
+    printf("    \"count\": %d,\n",        BENCH_WORLDS);
+    printf("    \"world_bytes\": %zu,\n", sizeof(World));
+    printf("    \"ticks\": %d,\n",        BENCH_WORLD_TICKS);
+    printf("    \"threads\": [\n");
+    for (int nthread = 1;; nthread = (nthread * 2 > ncore) ? ncore : nthread * 2) {
+        /* the same fights every time, so only the thread count changes */
+        srand(1);
+        for (int i = 0; i < BENCH_WORLDS; i++) {
+            world_init(worlds + i, &state.level);
+            bench_waffle(worlds + i, BENCH_WORLD_POTS);
+        }
+
+        pthread_t threads[nthread];
+        BenchWorker workers[nthread];
+        uint64_t start = stm_now();
+        for (int i = 0; i < nthread; i++) {
+            workers[i] = (BenchWorker) { .worlds = worlds, .first = i, .stride = nthread };
+            pthread_create(threads + i, NULL, bench_worker, workers + i);
+        }
+        for (int i = 0; i < nthread; i++)
+            pthread_join(threads[i], NULL);
+        double secs = stm_sec(stm_since(start));
+
+        double ticks_per_sec = BENCH_WORLDS * BENCH_WORLD_TICKS / secs;
+        printf("      { \"threads\": %d, \"ticks_per_sec\": %.0f, \"worlds_per_core_60hz\": %.1f }%s\n",
+               nthread, ticks_per_sec, ticks_per_sec / nthread / 60.0, (nthread == ncore) ? "" : ",");
+        if (nthread == ncore) break;
+    }
+    printf("    ]\n  }");
+    free(worlds);
+}
+
+/* a crowded world, snapshotted every tick against the snapshot from
+ * BENCH_SNAP_ACK_LAG ticks before (as if that's the last one a client acked),
+ * then decoded and applied to a second world. encode times include taking
+ * the snapshot, decode times include applying it */
+#define BENCH_SNAP_ENTS (1000)
+#define BENCH_SNAP_TICKS (120)
+#define BENCH_SNAP_ACK_LAG (6)
+
+static int bench_snap_eq(Snap *a, Snap *b) {
+    if (a->tick != b->tick || memcmp(&a->head, &b->head, sizeof(SnapHead))) return 0;
+    for (int i = 0; i < ENT_MAX; i++) {
+        SnapEnt *l = a->ents + i, *r = b->ents + i;
+        if (l->active != r->active || l->gen != r->gen || snap_ent_changes(l, r)) return 0;
+    }
+    if (a->nproj != b->nproj) return 0;
+    for (int i = 0; i < a->nproj; i++) {
+        SnapProj *l = a->projs + i, *r = b->projs + i;
+        if (l->pos[0] != r->pos[0] || l->pos[1] != r->pos[1] ||
+            l->vel[0] != r->vel[0] || l->vel[1] != r->vel[1] ||
+            l->owner.idx != r->owner.idx || l->owner.gen != r->owner.gen ||
+            l->hit_mask != r->hit_mask) return 0;
+    }
+    return 1;
+}
+
+/* each budget's high-water mark after everything above ran through it */
+static void bench_memory(void) {
+    printf("  \"memory\": {\n");
+    for (Arena *a = mem; (a - mem) < Mem_COUNT; a++)
+        printf("    \"%s\": { \"high\": %zu, \"cap\": %zu }%s\n",
+               a->name, a->high, a->cap, (a - mem) < Mem_COUNT - 1 ? "," : "");
+    printf("  }");
+}
+
+/* there are no frames here, so init() returning stands in for the first one */
+static void bench_startup(void) {
+    printf("  \"startup\": {\n");
+    printf("    \"loader_threads\": %d,\n", load.nthread);
+    printf("    \"first_frame_ms\": %.2f,\n", stm_ms(load.first_frame));
+    printf("    \"interactive_ms\": %.2f\n", stm_ms(load.interactive));
+    printf("  }");
+}
+
+static void bench_snapshots(void) {
+    static Snap snaps[BENCH_SNAP_ACK_LAG + 1], got, check;
+    static uint8_t buf[SNAP_MAX_BYTES];
+
+    World *w = calloc(sizeof(World), 2), *spectator = w + 1;
+    srand(1);
+    world_init(w, &state.level);
+    world_init(spectator, &state.level);
+    bench_waffle(w, BENCH_SNAP_ENTS);
+
+    int ents = 0;
+    SYSTEM(w, e) ents++;
+    snap_take(w, snaps);
+    size_t full_bytes = snap_encode(NULL, snaps, buf, sizeof(buf));
+    if (!snap_decode(NULL, &got, buf, full_bytes) || !bench_snap_eq(&got, snaps))
+        fprintf(stderr, "full snapshot didn't round trip\n"), exit(1);
+
+    uint64_t encode_t = 0, decode_t = 0;
+    size_t delta_bytes = 0, ent_ticks = 0;
+    for (int t = 1; t <= BENCH_SNAP_TICKS; t++) {
+        tick(w);
+        SYSTEM(w, e) ent_ticks++;
+
+        Snap *s = snaps + t % (BENCH_SNAP_ACK_LAG + 1);
+        Snap *base = snaps + ((t > BENCH_SNAP_ACK_LAG) ? t - BENCH_SNAP_ACK_LAG : 0) % (BENCH_SNAP_ACK_LAG + 1);
+
+        uint64_t start = stm_now();
+        snap_take(w, s);
+        size_t n = snap_encode(base, s, buf, sizeof(buf));
+        uint64_t encoded = stm_now();
+        int ok = snap_decode(base, &got, buf, n);
+        snap_apply(spectator, &got);
+        decode_t += stm_since(encoded);
+        encode_t += stm_diff(encoded, start);
+        delta_bytes += n;
+
+        snap_take(spectator, &check);
+        if (!n || !ok || !bench_snap_eq(&got, s) || !bench_snap_eq(&check, s))
+            fprintf(stderr, "snapshot %d didn't round trip\n", t), exit(1);
+    }
+    free(w);
+
+    printf("  \"snapshots\": {\n");
+    printf("    \"ents\": %d,\n",                         ents);
+    printf("    \"ticks\": %d,\n",                        BENCH_SNAP_TICKS);
+    printf("    \"ack_lag\": %d,\n",                      BENCH_SNAP_ACK_LAG);
+    printf("    \"raw_bytes_per_ent\": %zu,\n",           sizeof(Ent));
+    printf("    \"full_bytes_per_ent\": %.2f,\n",         full_bytes / (double)ents);
+    printf("    \"delta_bytes_per_ent_tick\": %.2f,\n",   delta_bytes / (double)ent_ticks);
+    printf("    \"encode_ents_per_sec\": %.0f,\n",        ent_ticks / stm_sec(encode_t));
+    printf("    \"decode_ents_per_sec\": %.0f,\n",        ent_ticks / stm_sec(decode_t));
+    printf("    \"encode_mb_per_sec\": %.1f\n",           delta_bytes / stm_sec(encode_t) / 1e6);
+    printf("  }");
+}
+
+/* everything runs unless some of it is named; --flags don't count as names */
+static int bench_wanted(int argc, char **argv, char *name) {
+    int named = 0, wanted = 0;
+    for (int i = 1; i < argc; i++)
+        if (argv[i][0] != '-') named = 1, wanted |= !strcmp(argv[i], name);
+    return wanted || !named;
+}
+
+int main(int argc, char **argv) {
+    init();
+    load.first_frame = stm_since(load.start);
+    while (!load_poll()) usleep(100);
+    bench_default_map = bench_map_dup(state.level.map);
+    for (int i = 1; i < argc; i++)
+        if (!strcmp(argv[i], "--trace")) trace_start(TRACE_PATH);
+
+    printf("{\n  \"ticks\": %d,\n  \"scenarios\": {\n", BENCH_TICKS);
+    int ran = 0;
+    for (Scenario *sc = scenarios; (sc - scenarios) < sizeof(scenarios) / sizeof(scenarios[0]); sc++) {
+        if (bench_wanted(argc, argv, sc->name)) bench_run(sc, !ran++);
+    }
+    printf("\n  }");
+
+    if (bench_wanted(argc, argv, "worlds"))    printf(",\n"), bench_worlds();
+    if (bench_wanted(argc, argv, "snapshots")) printf(",\n"), bench_snapshots();
+    printf(",\n"), bench_startup();
+    printf(",\n"), bench_memory();
+    printf("\n}\n");
+
+    cleanup();
+    return 0;
+}
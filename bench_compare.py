@@ -0,0 +1,61 @@
+import json
+import sys
+
+# compares build/bench.json (from ./build/bench) against bench_baseline.json.
+# a metric regresses if it's above baseline * ratio + slack, from the
+# baseline's "tolerance" table; metrics without a tolerance are only printed.
+#
+#   python3 bench_compare.py build/bench.json bench_baseline.json
+#   python3 bench_compare.py build/bench.json bench_baseline.json --update
+
+args = [a for a in sys.argv[1:] if not a.startswith('--')]
+results_path = args[0] if len(args) > 0 else 'build/bench.json'
+baseline_path = args[1] if len(args) > 1 else 'bench_baseline.json'
+
+with open(results_path) as f:
+    results = json.load(f)
+with open(baseline_path) as f:
+    baseline = json.load(f)
+
+if '--update' in sys.argv:
+    baseline['ticks'] = results['ticks']
+    baseline['scenarios'].update(results['scenarios'])
+    with open(baseline_path, 'w') as f:
+        json.dump(baseline, f, indent=2)
+        f.write('\n')
+    print(f"wrote {len(results['scenarios'])} scenarios to {baseline_path}")
+    sys.exit(0)
+
+if results['ticks'] != baseline['ticks']:
+    sys.exit(f"ran {results['ticks']} ticks, baseline is for {baseline['ticks']}")
+
+tolerance = baseline['tolerance']
+regressions = []
+for name, got in results['scenarios'].items():
+    want = baseline['scenarios'].get(name)
+    if want is None:
+        print(f"{name}: no baseline, skipping")
+        continue
+
+    print(name)
+    for metric, value in got.items():
+        base = want.get(metric)
+        tol = tolerance.get(metric)
+        if base is None or tol is None:
+            print(f"  {metric:16} {value:>12}")
+            continue
+
+        limit = base * tol['ratio'] + tol['slack']
+        change = (value - base) / base * 100.0 if base else 0.0
+        flag = ''
+        if value > limit:
+            flag = '  REGRESSED'
+            regressions.append(f"{name}.{metric}: {value} > {limit:.2f}")
+        print(f"  {metric:16} {value:>12} vs {base:>12} ({change:+6.1f}%){flag}")
+
+if regressions:
+    print(f"\n{len(regressions)} regression(s):")
+    for r in regressions:
+        print(f"  {r}")
+    sys.exit(1)
+print("\nno regressions")
@@ -0,0 +1,35 @@
+import bpy
+import json
+import os
+
+# run in blender with the mesh selected: writes its verts and triangles into
+# meshes.json, next to the .blend and under its name (bow.blend -> "bow").
+# mesh2flat.py compiles meshes.json into what the game loads
+mesh = bpy.context.active_object.data
+mesh.calc_loop_triangles()
+
+name = os.path.splitext(os.path.basename(bpy.data.filepath))[0]
+path = os.path.join(os.path.dirname(bpy.data.filepath), 'meshes.json')
+
+meshes = {}
+if os.path.exists(path):
+    with open(path) as f:
+        meshes = json.load(f)
+meshes[name] = {
+    "verts": [[round(v.co.x, 4), round(v.co.y, 4)] for v in mesh.vertices],
+    "tris": [[int(x) for x in t.vertices] for t in mesh.loop_triangles],
+}
+
+# a row per vert or triangle, so a re-export diffs nicely
+with open(path, 'w') as f:
+    f.write('{\n')
+    f.write(',\n'.join(
+        f'  "{n}": {{\n'
+        '    "verts": [\n' + ',\n'.join('      [%7.4f, %7.4f]' % tuple(v) for v in m['verts']) + '\n    ],\n'
+        '    "tris": [\n'  + ',\n'.join('      [%2d, %2d, %2d]' % tuple(t) for t in m['tris']) + '\n    ]\n'
+        '  }'
+        for n, m in meshes.items()
+    ))
+    f.write('\n}\n')
+
+print(f"wrote {len(mesh.vertices)} verts and {len(mesh.loop_triangles)} triangles to {name} in {path}")
@@ -0,0 +1,185 @@
+/* headless microbenchmark for the geometry writers: each write_* is called in
+ * a tight loop into a preallocated Geo with nothing uploaded, then a canned
+ * fight is written whole the way frame() writes it. prints json.
+ *
+ * ./bake.sh emit builds and runs this; ./build/emitbench circ text runs only
+ * the named emitters, and "scene" only the whole frame */
+#define HEADLESS
+
+#include <unistd.h>
+
+#include "main.c"
+
+#define EMIT_BATCHES (2048)
+#define EMIT_FRAMES (600)
+
+typedef struct {
+    char *name;
+    int batch; /* calls per batch, each batch into a fresh writer */
+    void (*emit)(GeoWtr *wtr, int i);
+    Geo *geo; /* dyn_geo unless set */
+} Emitter;
+
+/* i only moves things around so no two calls write quite the same thing */
+static float emit_x(int i) { return (i % 32) * 0.5f; }
+static float emit_y(int i) { return (i / 32) * 0.5f; }
+
+static void emit_circ (GeoWtr *wtr, int i) { write_circ (wtr, emit_x(i), emit_y(i), 0.6f, Color_Brown, emit_y(i)); }
+static void emit_rect (GeoWtr *wtr, int i) { write_rect (wtr, emit_x(i), emit_y(i), 0.8f, 1.6f, Color_Brown, emit_y(i)); }
+static void emit_sight(GeoWtr *wtr, int i) { write_sight(wtr, emit_x(i), emit_y(i), 0.3f, Color_Maroon, emit_y(i)); }
+static void emit_pot  (GeoWtr *wtr, int i) { write_pot  (wtr, emit_x(i), emit_y(i), 0.6f); }
+static void emit_sword(GeoWtr *wtr, int i) { write_sword(wtr, i * 0.1f, emit_x(i), emit_y(i), emit_y(i)); }
+static void emit_arrow(GeoWtr *wtr, int i) { write_arrow(wtr, i * 0.1f, emit_x(i), emit_y(i), emit_y(i)); }
+static void emit_line(GeoWtr *wtr, int i) {
+    write_line(wtr, emit_x(i), emit_y(i), emit_x(i) + 1.0f, emit_y(i) + 0.5f, 0.035f, Color_LightGrey, emit_y(i));
+}
+/* drawn halfway back, so the nocked arrow is written too */
+static Ent emit_archer = { .item = EntItem_Bow };
+static void emit_bow(GeoWtr *wtr, int i) {
+    write_bow(wtr, state.world, i * 0.1f, emit_x(i), emit_y(i), emit_y(i), &emit_archer);
+}
+/* about what a damage label is */
+static void emit_text(GeoWtr *wtr, int i) {
+    write_text(wtr, emit_x(i) * 40.0f, emit_y(i) * 40.0f, "123hp", Color_Red);
+}
+static void emit_frame(GeoWtr *wtr, int i) {
+    write_frame(wtr, emit_x(i) * 40.0f, emit_y(i) * 40.0f, 400.0f, 300.0f);
+}
+/* the chunk with the most trees, every level of it */
+static MapChunk *emit_chunk;
+static void emit_map(GeoWtr *wtr, int i) {
+    map_chunk_write(wtr, emit_chunk);
+}
+
+static Emitter emitters[] = {
+    { "circ",      64, emit_circ  },
+    { "rect",      64, emit_rect  },
+    { "line",      64, emit_line  },
+    { "sight",     64, emit_sight },
+    { "pot",       64, emit_pot   },
+    { "sword",     64, emit_sword },
+    { "arrow",     64, emit_arrow },
+    { "bow",       64, emit_bow   },
+    { "text",      64, emit_text  },
+    { "frame",     16, emit_frame },
+    { "map_chunk",  1, emit_map, &state.static_geo },
+};
+
+static int u64_cmp(const void *a, const void *b) {
+    uint64_t x = *(uint64_t *)a, y = *(uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static void emit_run(Emitter *em, int first) {
+    static uint64_t batch_t[EMIT_BATCHES];
+    Geo *geo = em->geo ? em->geo : &state.dyn_geo;
+    int batches = em->batch > 1 ? EMIT_BATCHES : EMIT_BATCHES / 8;
+
+    size_t verts = 0, idxs = 0;
+    for (int b = 0; b < batches; b++) {
+        uint64_t start = stm_now();
+        GeoWtr wtr = geo_wtr(geo);
+        wtr.scale = view_scale();
+        for (int i = 0; i < em->batch; i++) em->emit(&wtr, i);
+        batch_t[b] = stm_since(start);
+
+        geo_wtr_check(&wtr);
+        verts += wtr.vert - geo->verts;
+        idxs  += wtr.idx  - geo->idxs;
+    }
+
+    /* the median batch, so one descheduling doesn't move it */
+    qsort(batch_t, batches, sizeof(uint64_t), u64_cmp);
+    double ns = stm_ns(batch_t[batches / 2]) / em->batch;
+    double calls = (double)batches * em->batch;
+    double vert_per = verts / calls, idx_per = idxs / calls;
+    printf("%s    \"%s\": {\n", first ? "" : ",\n", em->name);
+    printf("      \"ns_per_prim\": %.1f,\n",     ns);
+    printf("      \"verts_per_prim\": %.1f,\n",  vert_per);
+    printf("      \"idxs_per_prim\": %.1f,\n",   idx_per);
+    printf("      \"bytes_per_prim\": %.0f,\n",  vert_per * sizeof(Vert) + idx_per * sizeof(uint16_t));
+    printf("      \"mverts_per_sec\": %.1f\n",   vert_per / ns * 1e3);
+    printf("    }");
+}
+
+/* the player aiming, beset by 128 pots with arrows in the air,
+ * after a second of fighting */
+static void emit_scene(void) {
+    World *w = state.world;
+    srand(1);
+    w->player->pos = vec2(9.0f, 3.0f);
+    w->aimer.active = 1;
+    for (int i = 0; i < 128; i++) {
+        float rads = (float)rand() / RAND_MAX * M_PI*2.0f, dist = 3.0f + (float)rand() / RAND_MAX * 5.0f;
+        ent_comp_set(w, ent_spawn_pot(w, add2(w->player->pos, mul2f(rads2(rads), dist)), 0.6f), EntComp_Aggroed, 1);
+    }
+    for (int t = 0; t < 60; t++) tick(w);
+    for (int i = 0; i < 64; i++) {
+        Vec2 dir = rads2(i / 64.0f * M_PI*2.0f);
+        proj_spawn(w, add2(w->player->pos, dir), mul2f(dir, 0.05f), edx_from(w, w->player), EntMask_Enemy);
+    }
+    state.cam = add2(w->player->pos, vec2(0.0f, 0.5f));
+}
+
+static void emit_scene_run(int first) {
+    static uint64_t frame_t[EMIT_FRAMES];
+    World *w = state.world;
+    size_t verts = 0, idxs = 0;
+    for (int f = 0; f < EMIT_FRAMES; f++) {
+        uint64_t start = stm_now();
+        GeoWtr wtr = geo_wtr(&state.dyn_geo);
+        write_world(&wtr, w);
+        write_hud(&wtr, w);
+        frame_t[f] = stm_since(start);
+
+        geo_wtr_check(&wtr);
+        verts = wtr.vert - state.dyn_geo.verts;
+        idxs  = wtr.idx  - state.dyn_geo.idxs;
+    }
+
+    qsort(frame_t, EMIT_FRAMES, sizeof(uint64_t), u64_cmp);
+    double p50 = stm_us(frame_t[EMIT_FRAMES / 2]);
+    printf("%s  \"scene\": {\n", first ? "" : ",\n");
+    printf("    \"live_ents\": %d,\n",        (int)ent_grid(w)->start[ENT_GRID_BUCKETS]);
+    printf("    \"live_projs\": %d,\n",       w->nproj);
+    printf("    \"emit_p50_us\": %.2f,\n",    p50);
+    printf("    \"emit_p99_us\": %.2f,\n",    stm_us(frame_t[EMIT_FRAMES * 99 / 100]));
+    printf("    \"verts\": %zu,\n",           verts);
+    printf("    \"idxs\": %zu,\n",            idxs);
+    printf("    \"bytes\": %zu,\n",           verts * sizeof(Vert) + idxs * sizeof(uint16_t));
+    printf("    \"mverts_per_sec\": %.1f\n",  verts / p50);
+    printf("  }");
+}
+
+static int emit_wanted(int argc, char **argv, char *name) {
+    if (argc < 2) return 1;
+    for (int i = 1; i < argc; i++)
+        if (!strcmp(argv[i], name)) return 1;
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    init();
+    load.first_frame = stm_since(load.start);
+    while (!load_poll()) usleep(100);
+
+    emit_archer.swing.end = state.world->tick + item_attack_duration[EntItem_Bow] / 2;
+    emit_chunk = state.chunks;
+    for (MapChunk *c = state.chunks; (c - state.chunks) < state.nchunk; c++)
+        if (c->nidx > emit_chunk->nidx) emit_chunk = c;
+
+    printf("{\n  \"emitters\": {\n");
+    int ran = 0;
+    for (Emitter *em = emitters; (em - emitters) < sizeof(emitters) / sizeof(emitters[0]); em++)
+        if (emit_wanted(argc, argv, em->name)) emit_run(em, !ran++);
+    printf("\n  }");
+
+    if (emit_wanted(argc, argv, "scene")) {
+        emit_scene();
+        emit_scene_run(0);
+    }
+    printf("\n}\n");
+
+    cleanup();
+    return 0;
+}
@@ -1,4 +1,5 @@
 import json
+import os
 import struct
 
 out = bytearray()
@@ -23,7 +24,7 @@ with open('build/map.h', 'w') as f:
         f.write(f"    uint32_t n{kd['inJson']};" + '\n');
     f.write('} MapData;\n\n')
 
-    f.write('static MapData parse_map_data(FILE *f) {\n');
+    f.write('static MapData parse_map_data(FILE *f, Arena *a) {\n');
     f.write('    MapData md = {0};\n');
     f.write('    uint32_t sec_len = 0;\n');
     for kd in kinds:
@@ -32,7 +33,7 @@ with open('build/map.h', 'w') as f:
         f.write(f'        perror("couldn\'t get map data section length"), exit(1);\n')
         f.write(f"    sec_len = md.n{kd['inJson']} = ntohl(sec_len);\n")
         f.write(f"    if (fread(\n")
-        f.write(f"        md.{kd['inJson']} = calloc(sizeof({data_type}), sec_len),\n")
+        f.write(f"        md.{kd['inJson']} = ARENA_ARRAY(a, {data_type}, sec_len),\n")
         f.write(f"        sizeof({data_type}),\n"),
         f.write(f"        sec_len,\n")
         f.write(f"        f\n")
@@ -53,7 +54,9 @@ with open("map.json", "r") as f:
                 en = pl
             out += struct.pack('f'*kd['floats'],  *en)
 
-with open('build/map.bytes', 'wb') as f:
+# the running game reloads map.bytes when it changes, so swap it in whole
+with open('build/map.bytes.tmp', 'wb') as f:
     f.write(out)
+os.replace('build/map.bytes.tmp', 'build/map.bytes')
 
 print("done!")
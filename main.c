@@ -1,15 +1,32 @@
 #include <math.h>
+#include <stdatomic.h>
+#include <sys/stat.h>
+#ifndef _MSC_VER
+    #include <fcntl.h>
+    #include <pthread.h>
+    #include <sys/mman.h>
+    #include <unistd.h>
+#endif
 
-#define SOKOL_IMPL
-#if defined(_MSC_VER)
+#if defined(HEADLESS)
+    /* no window, no gpu: sokol_gfx's dummy backend accepts and drops
+     * everything, and the bits of sokol_app we use are stubbed below */
+    #define SOKOL_TIME_IMPL
+    #define SOKOL_GFX_IMPL
+    #define SOKOL_DUMMY_BACKEND
+#elif defined(_MSC_VER)
+    #define SOKOL_IMPL
     #define SOKOL_D3D11
     #define SOKOL_LOG(str) OutputDebugStringA(str)
 #elif defined(__EMSCRIPTEN__)
+    #define SOKOL_IMPL
     #define SOKOL_GLES2
 #elif defined(__APPLE__)
     // NOTE: on macOS, sokol.c is compiled explicitly as ObjC 
+    #define SOKOL_IMPL
     #define SOKOL_METAL
 #else
+    #define SOKOL_IMPL
     #define SOKOL_GLCORE33
 #endif
 
@@ -18,6 +35,19 @@
 #include "sokol/sokol_gfx.h"
 #include "sokol/sokol_glue.h"
 
+#ifdef HEADLESS
+/* pretend to be the window sokol_main asks for */
+int sapp_width(void) { return 1280; }
+int sapp_height(void) { return 720; }
+float sapp_widthf(void) { return 1280.0f; }
+float sapp_heightf(void) { return 720.0f; }
+double sapp_frame_duration(void) { return 1.0 / 60.0; }
+void sapp_request_quit(void) { }
+sg_context_desc sapp_sgcontext(void) { return (sg_context_desc) {0}; }
+#endif
+
+#define POS_INF_F (INFINITY)
+
 static float signum(float f) { return (f > 0) - (f < 0); }
 static float lerp_rads(float a, float b, float t) {
   float difference = fmodf(b - a, M_PI*2.0f),
@@ -92,16 +122,162 @@ static Vec4 mul4x44(Mat4 m, Vec4 v) {
 
 #include "build/shaders.glsl.h"
 
+/* memory comes from one block taken at startup (mem_init), cut into fixed
+ * budgets that are only ever bumped and reset, never freed piece by piece.
+ * high is the most a budget has held, which is what mem_report is for */
+typedef struct {
+    const char *name;
+    uint8_t *base;
+    size_t cap, used, high;
+} Arena;
+#define ARENA_ALIGN (16)
+
+/* zeroed; running out of a budget is fatal, and says which */
+static void *arena_push(Arena *a, size_t size) {
+    size_t at = (a->used + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+    if (at > a->cap || size > a->cap - at)
+        printf("out of %s memory: wanted %zu bytes, %zu of %zu used\n", a->name, size, a->used, a->cap),
+        exit(1);
+    a->used = at + size;
+    if (a->used > a->high) a->high = a->used;
+    return memset(a->base + at, 0, size);
+}
+#define ARENA_ARRAY(a, T, n) ((T *)arena_push((a), sizeof(T) * (size_t)(n)))
+static void arena_reset(Arena *a) { a->used = 0; }
+
+/* trades blocks between two budgets of the same size; each keeps its name and high */
+static void arena_swap(Arena *a, Arena *b) {
+    Arena old = *a;
+    a->base = b->base, a->used = b->used;
+    b->base = old.base, b->used = old.used;
+    if (a->used > a->high) a->high = a->used;
+    if (b->used > b->high) b->high = b->used;
+}
+
 #include "build/map.h"
 
-// #define STB_RECT_PACK_IMPLEMENTATION
-// #include "stb/stb_rect_pack.h"
+#define STB_RECT_PACK_IMPLEMENTATION
+#include "stb/stb_rect_pack.h"
 
+/* what stb_truetype needs while it rasterizes a glyph comes out of Mem_Font,
+ * and glyph_get hands it all back once the glyph is done */
+static void *font_scratch_push(size_t size);
+#define STBTT_malloc(size, user) ((void)(user), font_scratch_push(size))
+#define STBTT_free(ptr, user) ((void)(ptr), (void)(user))
 #define STB_TRUETYPE_IMPLEMENTATION
 #include "stb/stb_truetype.h"
 
 typedef uint64_t Tick;
 
+/* opt-in tracing. F3 starts recording to TRACE_PATH and stops it again, leaving
+ * trace-event json for chrome://tracing or ui.perfetto.dev.
+ * each thread records into its own ring, which only it writes and only
+ * trace_drain (on the main thread, once a frame) reads, so recording takes no
+ * locks; a thread that outruns the drain drops events rather than wait.
+ * while nothing's recording, every TRACE_* is a load and a branch */
+#define TRACE_PATH "build/trace.json"
+#define TRACE_RING (1 << 14) /* events per thread, a power of two */
+#define TRACE_SLACK (1 << 6) /* kept free by begins, so the ends of those kept still fit */
+#define TRACE_THREADS (8)    /* the first this many threads to record get a ring */
+typedef enum { TraceKind_Begin, TraceKind_End, TraceKind_Counter } TraceKind;
+typedef struct {
+    uint64_t time; /* stm_now() */
+    TraceKind kind;
+    const char *name, *arg_names[2]; /* string literals, nothing to escape */
+    int32_t args[2];
+} TraceEvent;
+typedef struct {
+    _Atomic uint32_t head, tail, dropped;
+    uint32_t skip; /* begins dropped whose ends are yet to come */
+    uint32_t gen;  /* the trace skip counts for; like skip, only the owner touches it */
+    TraceEvent events[TRACE_RING];
+} TraceRing;
+static struct {
+    _Atomic int on;
+    _Atomic int nthread;
+    _Atomic uint32_t gen; /* bumped by each trace_start */
+    FILE *out;
+    uint64_t start;
+    size_t written;
+    uint32_t dropped; /* summed over the rings when the trace started */
+    TraceRing *rings; /* TRACE_THREADS of them, in Mem_Trace once a trace starts */
+} trace;
+static _Thread_local int trace_tid = -1;
+
+static void trace_push(TraceKind kind, const char *name, const char *a, int32_t av, const char *b, int32_t bv) {
+    if (trace_tid < 0) trace_tid = atomic_fetch_add(&trace.nthread, 1);
+    if (trace_tid >= TRACE_THREADS) return;
+
+    TraceRing *ring = trace.rings + trace_tid;
+    /* the ends skip was waiting on belong to a trace that's over */
+    uint32_t gen = atomic_load_explicit(&trace.gen, memory_order_relaxed);
+    if (ring->gen != gen) ring->gen = gen, ring->skip = 0;
+    if (kind == TraceKind_End && ring->skip) { ring->skip--; return; }
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed),
+             used = head - atomic_load_explicit(&ring->tail, memory_order_acquire);
+    if (used + ((kind == TraceKind_Begin) ? TRACE_SLACK : 1) > TRACE_RING) {
+        if (kind == TraceKind_Begin) ring->skip++;
+        atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+        return;
+    }
+    ring->events[head % TRACE_RING] = (TraceEvent) {
+        .time = stm_now(),
+        .kind = kind,
+        .name = name,
+        .arg_names = { a, b },
+        .args = { av, bv },
+    };
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+#define TRACING (atomic_load_explicit(&trace.on, memory_order_relaxed))
+#define TRACE_BEGIN(name) do { \
+    if (TRACING) trace_push(TraceKind_Begin, (name), NULL, 0, NULL, 0); \
+} while (0)
+#define TRACE_END(name) do { \
+    if (TRACING) trace_push(TraceKind_End, (name), NULL, 0, NULL, 0); \
+} while (0)
+/* an end that carries up to two named ints; a name can be NULL */
+#define TRACE_END_ARGS(name, a, av, b, bv) do { \
+    if (TRACING) trace_push(TraceKind_End, (name), (a), (av), (b), (bv)); \
+} while (0)
+/* one or two series on the counter track called name */
+#define TRACE_COUNTER(name, a, av, b, bv) do { \
+    if (TRACING) trace_push(TraceKind_Counter, (name), (a), (av), (b), (bv)); \
+} while (0)
+
+static void trace_write_args(TraceEvent *ev) {
+    int n = 0;
+    for (int i = 0; i < 2; i++)
+        if (ev->arg_names[i])
+            fprintf(trace.out, "%s\"%s\":%d", n++ ? "," : ",\"args\":{", ev->arg_names[i], ev->args[i]);
+    if (n) fputc('}', trace.out);
+}
+
+/* writes out everything the rings hold, less what was left from before this
+ * trace started: pushes that saw the last one still on */
+static void trace_drain(void) {
+    int nthread = atomic_load(&trace.nthread);
+    for (int tid = 0; tid < nthread && tid < TRACE_THREADS; tid++) {
+        TraceRing *ring = trace.rings + tid;
+        uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire),
+                 tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+        for (; tail != head; tail++) {
+            TraceEvent *ev = ring->events + tail % TRACE_RING;
+            if (ev->time < trace.start) continue;
+            double ts = stm_us(stm_diff(ev->time, trace.start));
+            if (ev->kind == TraceKind_Counter)
+                fprintf(trace.out, ",\n{\"name\":\"%s\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":1", ev->name, ts);
+            else
+                fprintf(trace.out, ",\n{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%d",
+                        ev->name, (ev->kind == TraceKind_Begin) ? 'B' : 'E', ts, tid);
+            trace_write_args(ev);
+            fputc('}', trace.out);
+            trace.written++;
+        }
+        atomic_store_explicit(&ring->tail, tail, memory_order_release);
+    }
+}
+
 typedef struct { float x, y, z, color, u, v; } Vert;
 typedef struct {
     Vert *verts;
@@ -109,16 +285,20 @@ typedef struct {
     int nvert, nidx;
     float min_z, max_z;
     sg_bindings bind;
+    const char *lvert, *lidx; /* what its buffers and counter tracks are called */
 } Geo;
-static Geo geo_alloc(int nvert, int nidx) {
+#define GEO_BYTES(nvert, nidx) (sizeof(Vert)*(nvert) + sizeof(uint16_t)*(nidx) + ARENA_ALIGN*2)
+static Geo geo_alloc(Arena *a, int nvert, int nidx) {
     return (Geo) {
         .nvert = nvert,
         .nidx = nidx,
-        .verts = calloc(sizeof(Vert), nvert),
-        .idxs = calloc(sizeof(uint16_t), nidx),
+        .verts = ARENA_ARRAY(a, Vert, nvert),
+        .idxs = ARENA_ARRAY(a, uint16_t, nidx),
     };
 }
 static void geo_bind_init(Geo *geo, const char *lvert, const char *lidx, sg_usage usg) {
+    geo->lvert = lvert;
+    geo->lidx = lidx;
     geo->bind.vertex_buffers[0] = sg_make_buffer(&(sg_buffer_desc) {
         .size = sizeof(Vert) * geo->nvert,
         .data = (usg == SG_USAGE_IMMUTABLE)
@@ -143,15 +323,131 @@ static void geo_find_z_range(Vert *beg, Vert *end) {
         geo_min_z = (i->z < geo_min_z) ? i->z : geo_min_z,
         geo_max_z = (i->z > geo_max_z) ? i->z : geo_max_z;
 }
+/* the nearest z among these; smaller z is nearer, it's what wins the depth test */
+static float geo_front_z(Vert *beg, Vert *end) {
+    float front = POS_INF_F;
+    for (Vert *i = beg; i != end; i++) front = fminf(front, i->z);
+    return front;
+}
+
+/* the map's trees are drawn from one immutable buffer pair per square chunk,
+ * so an edit to the map only has to re-upload the chunks it touched */
+#define MAP_PATH "build/map.bytes"
+#define MAP_WATCH_MS (250.0)
+#define MAP_CHUNK_SIZE (8.0f)
+#define MAP_CHUNK_MAX (1 << 8)
+#define MAP_CHUNK_BUCKETS (MAP_CHUNK_MAX * 2)
+#define MAP_CHUNK_OVERHANG (4.5f) /* how far a tree reaches past its position */
+
+/* every chunk holds its trees at each level of detail, one after the other,
+ * and the camera's zoom picks which range gets drawn */
+typedef enum { MapLod_Full, MapLod_Simple, MapLod_Blob, MapLod_COUNT } MapLod;
+/* the fewest pixels per world unit each level is drawn at */
+static float map_lod_min_scale[MapLod_COUNT] = { 24.0f, 8.0f, 0.0f };
+
+typedef struct {
+    int x, y; /* in chunks */
+    int nidx; /* over all levels */
+    int lod_first[MapLod_COUNT], lod_nidx[MapLod_COUNT];
+    float front_z; /* nearest z of any level, what opaque draws are ordered by */
+    uint8_t dirty;
+    sg_buffer vbuf, ibuf;
+} MapChunk;
+
+/* the palette and chunk meshes, baked ahead of time by pack.c into
+ * one file that startup maps and uploads as-is. whatever is missing or stale
+ * (the chunks, once the map changes) gets baked at startup instead */
+#define ASSET_PACK_PATH "build/assets.pack"
+#define ASSET_PACK_VERSION (4)
+#define ASSET_PACK_ALIGN (16)
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint32_t map_hash; /* of the trees the chunks were built from */
+    uint32_t nchunk;
+    float min_z, max_z;
+    uint32_t size; /* of the whole file, to catch truncation */
+    uint32_t _pad;
+} AssetPackHeader;
+typedef struct {
+    uint8_t palette[8*8*4];
+} AssetPackTex;
+/* followed by nchunk of these, then their verts and idxs */
+typedef struct {
+    int32_t x, y;
+    uint32_t nvert, nidx;
+    uint32_t lod_first[MapLod_COUNT], lod_nidx[MapLod_COUNT];
+    uint32_t vert_offset, idx_offset; /* from the start of the file */
+} AssetPackChunk;
 
 /* Entity Index - generationally indexed entity pointer */
 typedef struct { uint32_t idx, gen; } Edx;
 
+/* the map's circles, which never move and so don't need to be entities.
+ * sorted by x, so a query can sweep outward from its point and stop early */
+typedef struct { Vec2 pos; float radius; } TerrainCirc;
+
+/* terrain distance baked onto a grid at load time and sampled bilinearly,
+ * cached on disk beside map.bytes until the circles change */
+#define TERRAIN_SDF_PATH "build/terrain.sdf"
+#define TERRAIN_SDF_VERSION (1)
+#define TERRAIN_SDF_CELL (0.2f)
+#define TERRAIN_SDF_MARGIN (4.0f)
+#define TERRAIN_SDF_SLACK (0.01f) /* how far bilinear sampling may overshoot */
+typedef struct {
+    char magic[4];
+    uint32_t version, map_hash;
+    float origin_x, origin_y, cell;
+    int32_t w, h;
+} TerrainSdfHeader;
+typedef struct {
+    Vec2 origin;
+    int w, h; /* in samples, one more than in cells */
+    float *dist;
+} TerrainSdf;
+
+typedef struct {
+    TerrainCirc *circs;
+    int ncirc;
+    float max_radius;
+    TerrainSdf sdf;
+} Terrain;
+
+/* the map's circles, rasterized once into a coarse grid of blocked cells */
+#define NAV_CELL (0.5f)
+#define NAV_AGENT_RADIUS (0.35f)
+#define NAV_MAX_W (1 << 7)
+#define NAV_MAX_H (1 << 7)
+#define NAV_MAX_CELLS (NAV_MAX_W * NAV_MAX_H)
+typedef struct {
+    Vec2 origin; /* world position of the corner of cell 0 */
+    int w, h;
+    uint32_t gen; /* bumped by every rebuild, so flow fields over the old grid restart */
+    uint8_t blocked[NAV_MAX_CELLS];
+} NavGrid;
+
+/* breadth-first flow toward one goal cell over the NavGrid.
+ * grown a bit every tick it's used; restarted when the goal changes cell */
+#define FLOW_BUDGET (1 << 10) /* cells settled per tick */
+typedef struct {
+    int goal;       /* cell index, -1 before first use */
+    uint32_t gen;   /* of the NavGrid it was grown over */
+    Tick advanced;  /* last tick the frontier was grown */
+    int head, tail; /* frontier, as a range of queue */
+    uint16_t queue[NAV_MAX_CELLS];
+    uint8_t dir[NAV_MAX_CELLS]; /* 0 = unreached, else 1 + neighbor toward goal */
+} FlowField;
+
 #define WAFFLE_NSLOT (8)
+#define WAFFLE_NO_SLOT (WAFFLE_NSLOT + 1)
 #define WAFFLE_SLOT_OCCUPANCY_DIST (0.5f)
+#define WAFFLE_SLOT_REACH (20.0f) /* further than this from every free slot, and it waits */
+#define WAFFLE_SEARCHES (32) /* slot searches a tick; see waffle_update */
 typedef struct {
     Edx slots[WAFFLE_NSLOT];
     Edx attacker;
+    int search_from; /* the ent the next tick's slot searches start at */
+    FlowField flow[WAFFLE_NSLOT]; /* shared by everyone heading to a slot */
 } Waffle;
 
 
@@ -165,7 +461,6 @@ typedef enum {
     EntLooks_None,
     EntLooks_Player,
     EntLooks_Pot,
-    EntLooks_Arrow,
 } EntLooks;
 
 typedef enum {
@@ -189,11 +484,87 @@ float item_rot_offset[EntItem_COUNT] = {
 uint8_t item_always_point_down[EntItem_COUNT] = {
     [EntItem_Bow] = 1,
 };
+float item_reach[EntItem_COUNT] = { /* furthest it draws from where it's held */
+    [EntItem_Sword] = 1.7f,
+    [EntItem_Bow] = 1.25f,
+};
+/* furthest ent_item_pose ever holds an item from its ent: a hand is at most a
+ * unit out, and the sword's rest, swaying and jogging, a hair past that */
+#define ITEM_HOLD_MAX (1.05f)
 Tick item_attack_duration[EntItem_COUNT] = {
     [EntItem_Sword] = 50,
     [EntItem_Bow] = 85,
 };
 
+/* an attack, as keyframes played out over item_attack_duration. each key heads
+ * for a pose made from where the ent is aiming: the aim's angle (plus some
+ * swings), zero or the resting angle; the hand, drawn back along the aim, or
+ * the resting spot */
+#define ITEM_ANIM_KEYS (5)
+typedef enum {
+    AnimKey_Rotates = (1 << 1),
+    AnimKey_Moves   = (1 << 2),
+    AnimKey_Damages = (1 << 3),
+} AnimKeyFlag;
+typedef enum { AnimRot_Aim, AnimRot_Zero, AnimRot_Rest } AnimRot;
+typedef enum { AnimPos_Hand, AnimPos_Rest } AnimPos;
+typedef struct {
+    float duration; /* a fraction of the attack */
+    AnimKeyFlag flags;
+    AnimRot rot; float swings; /* added to AnimRot_Aim, half a radian each, toward the facing */
+    AnimPos pos; float pull;   /* how far AnimPos_Hand is drawn back along the aim */
+} AnimKey;
+const AnimKey item_anim[EntItem_COUNT][ITEM_ANIM_KEYS] = {
+    [EntItem_Sword] = {
+        { 0.2174f,                   AnimKey_Rotates | AnimKey_Moves, AnimRot_Aim,  -1.0f, AnimPos_Hand },
+        { 0.2304f,                   AnimKey_Rotates                , AnimRot_Aim,  -2.0f               },
+        { 0.0870f, AnimKey_Damages | AnimKey_Rotates                , AnimRot_Aim,   2.0f               },
+        { 0.2478f,                   AnimKey_Rotates                , AnimRot_Aim,   3.0f               },
+        { 0.2174f,                   AnimKey_Rotates | AnimKey_Moves, AnimRot_Rest,  0.0f, AnimPos_Rest },
+    },
+    /* ready, backup, FIRE, recover, return */
+    [EntItem_Bow] = {
+        { 0.2703f,                   AnimKey_Moves | AnimKey_Rotates, AnimRot_Aim,  0.0f, AnimPos_Hand       },
+        { 0.2703f,                   AnimKey_Moves                  , AnimRot_Zero, 0.0f, AnimPos_Hand, 0.2f },
+        { 0.0541f, AnimKey_Damages | AnimKey_Moves                  , AnimRot_Zero, 0.0f, AnimPos_Hand, 0.6f },
+        { 0.1351f,                   AnimKey_Moves                  , AnimRot_Zero, 0.0f, AnimPos_Hand       },
+        { 0.2703f,                   AnimKey_Moves | AnimKey_Rotates, AnimRot_Rest, 0.0f, AnimPos_Rest       },
+    },
+};
+
+/* where an ent's item is, relative to the ent, as of the tick it was worked out for */
+typedef struct {
+    Tick fresh; /* that tick + 1, so a zeroed pose is never fresh */
+    float rot;
+    Vec2 pos;
+    uint8_t dmg;
+} ItemPose;
+
+/* which components an entity has, tracked as one bitset per component
+ * (a bit per slot in World.ents) so systems can skip straight to theirs */
+typedef enum {
+    EntComp_Active,
+    EntComp_Hostile,
+    EntComp_Aggroed,
+    EntComp_HasItem,    /* item != EntItem_None */
+    EntComp_Moving,     /* vel isn't zero */
+    EntComp_Renderable, /* looks != EntLooks_None */
+    EntComp_Collider,   /* has_mask isn't zero */
+    EntComp_Swinging,   /* until the tick after swing.end, see ent_swing_until */
+    EntComp_Awake,      /* near enough the player to be simulated, see sim_retier */
+    EntComp_Coarse,     /* awake, but only stepped every SIM_MID_STRIDE ticks */
+    EntComp_COUNT,
+} EntComp;
+#define COMP(name) (1u << EntComp_##name)
+
+/* what a Timer does once it's due. see timers_fire */
+typedef enum {
+    TimerKind_SwingEnd, /* the ent stops Swinging */
+    TimerKind_Aggro,    /* the ent may be close enough to the player to aggro */
+    TimerKind_ENT_COUNT, /* those above are an ent's, with one of each pending at most */
+    TimerKind_DmgLbl = TimerKind_ENT_COUNT, /* a damage label fades */
+} TimerKind;
+
 typedef struct Ent Ent;
 struct Ent {
     /* bookkeeping */
@@ -205,7 +576,7 @@ struct Ent {
 
     /* combat */
     Tick last_damaged;
-    uint8_t hp, hostile, aggroed, pointy;
+    uint8_t hp;
 
     /* physics */
     float radius, friction;
@@ -215,13 +586,18 @@ struct Ent {
     /* held item */
     EntItem item;
     struct { Tick end; Vec2 toward; uint8_t shot; } swing;
+    ItemPose pose; /* see ent_item_pose */
+
+    uint16_t timers[TimerKind_ENT_COUNT]; /* 1 + its pending Timer of each kind, or 0 */
+    uint8_t waffle_slot; /* 1 + the one it's headed for, WAFFLE_NO_SLOT for none, 0 before it's looked */
 };
 
 typedef struct {
-    Vec2 pos;
+    Vec2 pos; /* in the world; the hud projects it */
     uint8_t hp;
-    Tick tick;
+    Tick tick; /* 0 once it has faded */
     Ent *ent;
+    uint16_t timer;
 } DmgLbl;
 
 typedef enum {
@@ -255,64 +631,435 @@ typedef struct {
     Vec2 last_mouse;
 } UiState;
 
-/* application state */
-static struct {
+#define ENT_MAX (1 << 10)
+#define ENT_WORDS (ENT_MAX / 64)
+
+/* cosmetic bits of debris: no collisions, not ents, they just drift and shrink.
+ * kept as separate arrays so parts_update is a couple of straight loops */
+#define PART_MAX (1 << 14) /* a multiple of 8, see parts_update */
+#define PART_DRAG (0.9f)
+typedef struct {
+    int count;
+    uint32_t rng; /* its own, so worlds on other threads don't share rand()'s */
+    float x[PART_MAX], y[PART_MAX], vx[PART_MAX], vy[PART_MAX];
+    float size[PART_MAX], shrink[PART_MAX]; /* gone once size runs out */
+    uint8_t color[PART_MAX];
+} Parts;
+
+/* arrows in flight. not ents: they only fly until they hit something,
+ * so they don't need the pool, the components or the physics */
+#define PROJ_MAX (1 << 11)
+typedef struct {
+    Vec2 pos, vel;
+    Edx owner;
+    EntMask hit_mask;
+} Proj;
+
+/* the ents bucketed by which cell of the world they're in, so drawing only
+ * looks at those near the view. cells are hashed into a fixed number of
+ * buckets, so a bucket can hold far apart ents; the precise test sorts them out */
+#define ENT_GRID_CELL (4.0f)
+#define ENT_GRID_BUCKETS (1 << 8)
+typedef struct {
+    Tick fresh;  /* the tick it was built for + 1 */
+    float reach; /* furthest any ent draws from its pos */
+    uint16_t start[ENT_GRID_BUCKETS + 1];
+    uint16_t ents[ENT_MAX];
+    float reaches[ENT_MAX]; /* each of ents' */
+} EntGrid;
+
+/* deadlines, so nothing has to be checked every tick to see if its time has come.
+ * a hierarchical wheel: the first level has a slot per tick, each level after
+ * has slots TIMER_SLOTS times as wide, and a slot's timers cascade down a level
+ * when its time comes. arming, cancelling and firing are O(1), and a tick with
+ * nothing due looks at one empty slot */
+#define TIMER_SLOT_BITS (6)
+#define TIMER_SLOTS (1 << TIMER_SLOT_BITS)
+#define TIMER_LEVELS (3)
+#define TIMER_HORIZON (TIMER_SLOTS * TIMER_SLOTS) /* later ones fire early, and are rearmed */
+#define DMG_LBL_MAX (1 << 7)
+#define TIMER_MAX (ENT_MAX * TimerKind_ENT_COUNT + DMG_LBL_MAX)
+typedef struct {
+    Tick at;
+    Edx of; /* for DmgLbl, idx is the label's and gen is 0 */
+    uint8_t kind;
+    uint16_t slot;       /* level * TIMER_SLOTS + slot in the level */
+    uint16_t prev, next; /* 1 + neighbours in its slot, or the free list; 0 ends it */
+} Timer;
+typedef struct {
+    Timer timers[TIMER_MAX];
+    uint16_t free; /* 1 + first unused timer */
+    uint16_t slots[TIMER_LEVELS * TIMER_SLOTS]; /* 1 + first timer in each */
+} TimerWheel;
+
+/* what a world plays on. shared by every world, and only changed
+ * between ticks, when the map is reloaded */
+typedef struct {
     MapData map;
-    
-    uint8_t keys[SAPP_MAX_KEYCODES];
+    Terrain terrain;
+    NavGrid nav;
+} Level;
+
+/* one simulation. tick() touches nothing outside of its World and the
+ * (read-only) Level, so any number of them can be stepped at once */
+typedef struct {
+    Level *level;
+
+    Ent ents[ENT_MAX];
+    uint64_t comps[EntComp_COUNT][ENT_WORDS];
+    DmgLbl dmg_lbls[DMG_LBL_MAX];
+
+    Tick tick;
+    struct { float breathe, jog; } idle; /* how everyone's items sway this tick */
+    Ent *player;
+    Waffle waffle;
+    Parts *parts; /* NULL for worlds nobody's watching */
+
+    Proj projs[PROJ_MAX];
+    int nproj;
+
+    EntGrid grid; /* see ent_grid */
+    TimerWheel timers;
+
+    /* what the player is doing, set by whoever's driving it before each tick */
+    struct { Vec2 move; uint8_t hold; } input;
     struct { uint8_t active; Vec2 pos; } aimer;
+} World;
+
+/* the budgets everything the game keeps is carved from */
+#define STATIC_GEO_NVERT (1 << 16) /* a chunk is at most this, around 600 trees */
+#define STATIC_GEO_NIDX  (1 << 18)
+#define DYN_GEO_NVERT    (1 << 15)
+#define DYN_GEO_NIDX     (1 << 17)
+#define PART_GEO_NVERT   (PART_MAX * 3)
+#define GLYPH_ATLAS      (512) /* texels a side */
+#define GLYPH_SCRATCH    (256 << 10) /* stb_truetype's, for one glyph at a time */
+typedef enum {
+    Mem_StaticGeo,
+    Mem_DynGeo,
+    Mem_Map,     /* the Level's map arrays, terrain circles and sdf */
+    Mem_MapNext, /* where map_reload builds the next Level, then swaps with Mem_Map */
+    Mem_Ents,
+    Mem_Ui,
+    Mem_Frame,   /* scratch, reset at the top of every frame() */
+    Mem_Font,    /* the glyph atlas */
+    Mem_Trace,   /* the trace rings, taken when tracing first starts */
+    Mem_COUNT,
+} Mem;
+static Arena mem[Mem_COUNT] = {
+    [Mem_StaticGeo] = { "static geo", .cap = GEO_BYTES(STATIC_GEO_NVERT, STATIC_GEO_NIDX) },
+    [Mem_DynGeo]    = { "dyn geo",    .cap = GEO_BYTES(DYN_GEO_NVERT, DYN_GEO_NIDX) +
+                                             GEO_BYTES(PART_GEO_NVERT, PART_GEO_NVERT) },
+    [Mem_Map]       = { "map",        .cap = 2 << 20 },
+    [Mem_MapNext]   = { "map next",   .cap = 2 << 20 },
+    [Mem_Ents]      = { "ents",       .cap = sizeof(World) + sizeof(Parts) + ARENA_ALIGN*2 },
+    [Mem_Ui]        = { "ui",         .cap = sizeof(UiState) + ARENA_ALIGN },
+    [Mem_Frame]     = { "frame",      .cap = 2 << 20 },
+    [Mem_Font]      = { "font",       .cap = GLYPH_ATLAS*GLYPH_ATLAS + GLYPH_SCRATCH },
+    [Mem_Trace]     = { "trace",      .cap = sizeof(TraceRing) * TRACE_THREADS },
+};
+
+static void mem_init(void) {
+    size_t total = 0;
+    for (Arena *a = mem; (a - mem) < Mem_COUNT; a++)
+        a->cap = (a->cap + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1),
+        total += a->cap;
+
+    uint8_t *block = calloc(1, total);
+    if (!block) printf("couldn't get %zu bytes for the memory budgets\n", total), exit(1);
+    for (Arena *a = mem; (a - mem) < Mem_COUNT; a++)
+        a->base = block, block += a->cap;
+}
+
+static void *font_scratch_push(size_t size) {
+    return arena_push(mem + Mem_Font, size);
+}
+
+/* to stderr, so it stays out of the bench's json */
+static void mem_report(void) {
+    size_t high = 0, cap = 0;
+    fprintf(stderr, "%-10s %10s %10s %10s\n", "budget", "high", "used", "cap");
+    for (Arena *a = mem; (a - mem) < Mem_COUNT; a++) {
+        fprintf(stderr, "%-10s %10zu %10zu %10zu %5.1f%%\n",
+                a->name, a->high, a->used, a->cap, 100.0 * a->high / a->cap);
+        high += a->high, cap += a->cap;
+    }
+    fprintf(stderr, "%-10s %10zu %10s %10zu %5.1f%%\n", "total", high, "", cap, 100.0 * high / cap);
+}
 
-    Ent ents[1 << 10];
-    DmgLbl dmg_lbls[1 << 7];
+static void trace_start(const char *path) {
+    if (TRACING) return;
+    if (!(trace.out = fopen(path, "w"))) { perror("couldn't open trace"); return; }
+    trace.start = stm_now();
+    trace.written = 0;
+    if (!trace.rings) trace.rings = ARENA_ARRAY(mem + Mem_Trace, TraceRing, TRACE_THREADS);
+    /* the rings are other threads', so they're left as they are: each resets
+     * its own skip when it sees gen move, and the drain passes over the rest */
+    trace.dropped = 0;
+    for (TraceRing *ring = trace.rings; (ring - trace.rings) < TRACE_THREADS; ring++)
+        trace.dropped += atomic_load(&ring->dropped);
+    atomic_fetch_add(&trace.gen, 1);
+    fputs("{\"traceEvents\":[\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"rpgc\"}}", trace.out);
+    atomic_store(&trace.on, 1);
+    fprintf(stderr, "tracing to %s\n", path);
+}
+
+static void trace_stop(void) {
+    if (!TRACING) return;
+    atomic_store(&trace.on, 0);
+    trace_drain();
+
+    uint32_t dropped = -trace.dropped;
+    for (TraceRing *ring = trace.rings; (ring - trace.rings) < TRACE_THREADS; ring++)
+        dropped += atomic_load(&ring->dropped);
+    fputs("\n]}\n", trace.out);
+    fclose(trace.out);
+    trace.out = NULL;
+    fprintf(stderr, "wrote %zu trace events, dropped %u\n", trace.written, dropped);
+}
+
+/* input latency: from an event arriving to the sg_commit() of the first frame
+ * that shows it. game input shows once a tick has run after it, ui input on the
+ * next frame. vsync and the compositor add their own on top of that */
+#define INPUT_PENDING_MAX 32
+#define LATENCY_BUCKET_MS 0.5
+#define LATENCY_BUCKETS   96 /* the last catches everything beyond */
+typedef struct { uint64_t at[INPUT_PENDING_MAX]; int n; } InputPending;
+typedef struct { uint32_t n, bucket[LATENCY_BUCKETS]; double max_ms; } LatencyHist;
 
-    UiState ui;
+/* application state: the world in the window, and everything that shows it */
+static struct {
+    Level level;
+    World *world;
+    Parts *parts; /* world's */
+
+    uint8_t keys[SAPP_MAX_KEYCODES];
+    UiState *ui;
+    struct {
+        InputPending ui, game; /* events not on screen yet */
+        uint8_t late;          /* F4: waiting game input pulls the next tick into this frame */
+        LatencyHist hist[2];   /* by late */
+    } input;
 
     uint64_t frame; /* a sokol_time tick, not one of our game ticks */
-    Tick tick;
     double fixed_tick_accumulator;
 
-    Ent *player;
-    Waffle waffle;
     Vec2 cam;
+    float zoom; /* half the view's width, in world units */
 
-    Geo static_geo, dyn_geo;
-    size_t static_geo_n_idx;
+    /* static_geo is only scratch space for building chunks */
+    Geo static_geo, dyn_geo, part_geo;
+    MapChunk chunks[MAP_CHUNK_MAX];
+    int nchunk;
+    uint16_t chunk_lookup[MAP_CHUNK_BUCKETS]; /* a chunk's index + 1, 0 if empty */
+    struct { time_t mtime; long long size; uint8_t pending; uint64_t checked; } map_watch;
 
-    sg_pipeline pip;
+    /* everything but text is opaque, and drawn without blending */
+    sg_pipeline pip, blend_pip;
     sg_pass_action pass_action;
 } state;
-#define ENT_MAX (sizeof(state.ents) / sizeof(state.ents[0]))
+
+static int ent_has(World *w, Ent *e, uint32_t comps) {
+    size_t i = e - w->ents;
+    for (; comps; comps &= comps - 1)
+        if (!(w->comps[__builtin_ctz(comps)][i / 64] & (1ull << (i % 64))))
+            return 0;
+    return 1;
+}
+static void ent_comp_set(World *w, Ent *e, EntComp c, int on) {
+    size_t i = e - w->ents;
+    if (on) w->comps[c][i / 64] |=  (1ull << (i % 64));
+    else    w->comps[c][i / 64] &= ~(1ull << (i % 64));
+}
+/* the ents in 64 consecutive slots that have all of `comps` */
+static uint64_t ent_query_word(World *w, uint32_t comps, int word) {
+    uint64_t bits = ~0ull;
+    for (int c = 0; c < EntComp_COUNT; c++)
+        if (comps & (1u << c)) bits &= w->comps[c][word];
+    return bits;
+}
 
 /* appropriating ECS terminology here.
- * a SYSTEM is just something that iterates over all entities. */
-#define SYSTEM(e) for (Ent *e = state.ents; (e - state.ents) < ENT_MAX; e++) if (e->active)
-#define UI_SYSTEM(b) for (UiBox *b = state.ui.boxes; (b - state.ui.boxes) < UI_BOX_COUNT; b++) if (b->looks) 
-static Ent *ent_alloc(void) {
-    for (int i = 0; i < ENT_MAX; i++)
-        if (!state.ents[i].active) {
-            state.ents[i] = (Ent) {
-                .active = 1,
-                .gen = state.ents[i].gen,
-                .swing.toward.x = 1.0f
-            };
-            return state.ents + i;
-        }
+ * a SYSTEM is just something that iterates over all of a world's entities.
+ * a QUERY only visits those with all of some COMP()s, a word of bits at a time,
+ * rechecking each one in case an earlier iteration removed it.
+ * (note: `break` in a QUERY body only skips to the next ent) */
+#define SYSTEM(w, e) for (Ent *e = (w)->ents; (e - (w)->ents) < ENT_MAX; e++) if (e->active)
+#define QUERY(w, e, comps) \
+    for (int _qw = 0; _qw < ENT_WORDS; _qw++) \
+        for (uint64_t _qb = ent_query_word((w), (comps), _qw); _qb; _qb &= _qb - 1) \
+            for (Ent *e = (w)->ents + _qw*64 + __builtin_ctzll(_qb); e && ent_has((w), e, (comps)); e = NULL)
+#define UI_SYSTEM(b) for (UiBox *b = state.ui->boxes; (b - state.ui->boxes) < UI_BOX_COUNT; b++) if (b->looks) 
+static Edx edx_from(World *w, Ent *ent) {
+    return (Edx) { .idx = (ent - w->ents) + 1, .gen = ent->gen };
+}
+static Ent *edx_deref(World *w, Edx edx) {
+    return (edx.idx > 0 && edx.gen == w->ents[edx.idx-1].gen)
+        ? (w->ents + edx.idx - 1)
+        : NULL;
+}
+
+static void timers_init(World *w) {
+    TimerWheel *tw = &w->timers;
+    memset(tw->slots, 0, sizeof(tw->slots));
+    for (int i = 0; i < TIMER_MAX; i++)
+        tw->timers[i].next = (i + 1 < TIMER_MAX) ? i + 2 : 0;
+    tw->free = 1;
+}
+
+/* the slot a timer due at `at` waits in: the lowest level whose slots are
+ * as wide as the bits it and the current tick differ in */
+static void timer_link(World *w, int i) {
+    TimerWheel *tw = &w->timers;
+    Timer *t = tw->timers + i;
+    Tick differ = t->at ^ w->tick;
+    int level = (differ < TIMER_SLOTS) ? 0 : (differ < TIMER_HORIZON) ? 1 : 2;
+    t->slot = level * TIMER_SLOTS + ((t->at >> (level * TIMER_SLOT_BITS)) & (TIMER_SLOTS - 1));
+    t->prev = 0;
+    t->next = tw->slots[t->slot];
+    if (t->next) tw->timers[t->next - 1].prev = i + 1;
+    tw->slots[t->slot] = i + 1;
+}
+static void timer_unlink(World *w, int i) {
+    TimerWheel *tw = &w->timers;
+    Timer *t = tw->timers + i;
+    if (t->prev) tw->timers[t->prev - 1].next = t->next;
+    else tw->slots[t->slot] = t->next;
+    if (t->next) tw->timers[t->next - 1].prev = t->prev;
+}
+
+/* where the 1 + index of the pending timer of this kind for `of` is kept */
+static uint16_t *timer_handle(World *w, TimerKind kind, Edx of) {
+    return (kind == TimerKind_DmgLbl)
+        ? &w->dmg_lbls[of.idx].timer
+        : w->ents[of.idx - 1].timers + kind;
+}
+
+/* replaces the pending one of the same kind for the same thing, if any */
+static void timer_arm(World *w, TimerKind kind, Edx of, Tick at) {
+    TimerWheel *tw = &w->timers;
+    uint16_t *handle = timer_handle(w, kind, of);
+    if (*handle) timer_unlink(w, *handle - 1);
+    else {
+        /* TIMER_MAX has room for one of each kind for everything */
+        *handle = tw->free;
+        tw->free = tw->timers[tw->free - 1].next;
+    }
+
+    Timer *t = tw->timers + *handle - 1;
+    t->at = (at <= w->tick) ? w->tick + 1 :
+            (at - w->tick > TIMER_HORIZON) ? w->tick + TIMER_HORIZON : at;
+    t->of = of;
+    t->kind = kind;
+    timer_link(w, *handle - 1);
+}
+static void timer_cancel(World *w, uint16_t *handle) {
+    if (!*handle) return;
+    TimerWheel *tw = &w->timers;
+    timer_unlink(w, *handle - 1);
+    tw->timers[*handle - 1].next = tw->free;
+    tw->free = *handle;
+    *handle = 0;
+}
+
+static Ent *ent_alloc(World *w) {
+    for (int word = 0; word < ENT_WORDS; word++) {
+        if (!~w->comps[EntComp_Active][word]) continue;
+
+        int i = word*64 + __builtin_ctzll(~w->comps[EntComp_Active][word]);
+        w->ents[i] = (Ent) {
+            .active = 1,
+            .gen = w->ents[i].gen,
+            .swing.toward.x = 1.0f
+        };
+        ent_comp_set(w, w->ents + i, EntComp_Active, 1);
+        ent_comp_set(w, w->ents + i, EntComp_Awake, 1); /* until sim_retier gets to it */
+        return w->ents + i;
+    }
     puts("entity pool exhausted"), exit(1);
 }
-static void ent_free(Ent *ent) {
+static void ent_free(World *w, Ent *ent) {
+    for (TimerKind k = 0; k < TimerKind_ENT_COUNT; k++)
+        timer_cancel(w, ent->timers + k);
     ent->gen++;
     ent->active = 0;
+    for (int c = 0; c < EntComp_COUNT; c++)
+        ent_comp_set(w, ent, c, 0);
+}
+
+/* field changes that move an ent in or out of a component go through these */
+/* both change what ent_grid holds for e */
+static void ent_set_item(World *w, Ent *e, EntItem item) {
+    e->item = item;
+    ent_comp_set(w, e, EntComp_HasItem, item != EntItem_None);
+    w->grid.fresh = 0;
+}
+static void ent_set_looks(World *w, Ent *e, EntLooks looks) {
+    e->looks = looks;
+    ent_comp_set(w, e, EntComp_Renderable, looks != EntLooks_None);
+    w->grid.fresh = 0;
+}
+static void ent_set_has_mask(World *w, Ent *e, EntMask mask) {
+    e->has_mask = mask;
+    ent_comp_set(w, e, EntComp_Collider, mask != 0);
+}
+/* a swing only ends through its timer, so nothing has to poll swing.end */
+static void ent_swing_until(World *w, Ent *e, Tick end) {
+    e->swing.end = end;
+    ent_comp_set(w, e, EntComp_Swinging, 1);
+    timer_arm(w, TimerKind_SwingEnd, edx_from(w, e), end + 1);
+}
+/* hostiles look for the player on a timer, see timers_fire */
+static void ent_set_hostile(World *w, Ent *e, int hostile) {
+    ent_comp_set(w, e, EntComp_Hostile, hostile);
+    if (hostile) timer_arm(w, TimerKind_Aggro, edx_from(w, e), w->tick + 1);
 }
-static void dmg_lbl_push(uint8_t hp, Vec2 pos, Ent *ent);
-static int ent_damage(Ent *hit, Ent *hitter) {
+static void ent_push(World *w, Ent *e, Vec2 dv) {
+    e->vel = add2(e->vel, dv);
+    if (dv.x != 0.0f || dv.y != 0.0f) ent_comp_set(w, e, EntComp_Moving, 1);
+}
+static Ent *ent_spawn_player(World *w) {
+    Ent *e = ent_alloc(w);
+    ent_set_has_mask(w, e, EntMask_Player);
+    e->hit_mask = ~EntMask_Player;
+    e->item_hit_mask = EntMask_Enemy;
+    ent_set_looks(w, e, EntLooks_Player);
+    ent_set_item(w, e, EntItem_Bow);
+    e->hp = 15;
+    e->radius = 0.2f;
+    return e;
+}
+static Ent *ent_spawn_pot(World *w, Vec2 pos, float radius) {
+    Ent *e = ent_alloc(w);
+    e->pos = pos;
+    e->radius = radius;
+    ent_set_looks(w, e, EntLooks_Pot);
+    ent_set_item(w, e, EntItem_Sword);
+    ent_set_has_mask(w, e, EntMask_Enemy);
+    e->hit_mask = ~0;
+    e->item_hit_mask = EntMask_Player;
+    ent_set_hostile(w, e, 1);
+    e->hp = 3;
+    return e;
+}
+/* once the pool is full, new ones are dropped */
+static void proj_spawn(World *w, Vec2 pos, Vec2 vel, Edx owner, EntMask hit_mask) {
+    if (w->nproj == PROJ_MAX) return;
+    w->projs[w->nproj++] = (Proj) { .pos = pos, .vel = vel, .owner = owner, .hit_mask = hit_mask };
+}
+
+static void dmg_lbl_push(World *w, uint8_t hp, Vec2 pos, Ent *ent);
+static void parts_hit(World *w, Ent *hit);
+static int ent_damage(World *w, Ent *hit, Ent *hitter) {
     uint8_t dmg = 1; // hitter->item == EntItem_Sword;
 
-    int can_damage = state.tick - hit->last_damaged > 5;
+    int can_damage = w->tick - hit->last_damaged > 5;
     if (can_damage) {
-        dmg_lbl_push(dmg, add2(hit->pos, vec2(0.0f, 1.0f)), hit);
-        hit->last_damaged = state.tick;
+        dmg_lbl_push(w, dmg, add2(hit->pos, vec2(0.0f, 1.0f)), hit);
+        parts_hit(w, hit);
+        hit->last_damaged = w->tick;
         if (hit->hp < dmg)
-            ent_free(hit);
+            ent_free(w, hit);
         else
             hit->hp -= dmg;
     }
@@ -325,105 +1072,1097 @@ static float ent_speed(Ent *e) {
         : 0.0045f;
 }
 
-static Edx edx_from(Ent *ent) {
-    return (Edx) { .idx = (ent - state.ents) + 1, .gen = ent->gen };
+static int terrain_circ_cmp(const void *a, const void *b) {
+    float ax = ((TerrainCirc *)a)->pos.x, bx = ((TerrainCirc *)b)->pos.x;
+    return (ax > bx) - (ax < bx);
 }
-static Ent *edx_deref(Edx edx) {
-    return (edx.idx > 0 && edx.gen == state.ents[edx.idx-1].gen)
-        ? (state.ents + edx.idx - 1)
-        : NULL;
+
+static void terrain_init(Terrain *ter, MapData *md, Arena *a) {
+    ter->ncirc = md->ncircles;
+    ter->circs = ARENA_ARRAY(a, TerrainCirc, ter->ncirc);
+    ter->max_radius = 0.0f;
+    for (int i = 0; i < ter->ncirc; i++) {
+        MapData_Circle *c = md->circles + i;
+        ter->circs[i] = (TerrainCirc) { .pos = vec2(c->x, c->y), .radius = c->radius };
+        ter->max_radius = fmaxf(ter->max_radius, c->radius);
+    }
+    qsort(ter->circs, ter->ncirc, sizeof(TerrainCirc), terrain_circ_cmp);
 }
 
-static Vec2 waffle_slot_pos(int slot_i) {
-    float angle = ((float)slot_i / (float)WAFFLE_NSLOT) * M_PI * 2.0f;
-    return add2(state.player->pos, mul2f(rads2(angle), 2.0f));
+/* signed distance from p to the nearest terrain circle */
+static float terrain_distance(Terrain *ter, Vec2 p, TerrainCirc **hit) {
+    float dist = POS_INF_F;
+
+    /* first circle at or right of p */
+    int lo = 0, hi = ter->ncirc;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (ter->circs[mid].pos.x < p.x) lo = mid + 1;
+        else                             hi = mid;
+    }
+
+#define VISIT(c) { \
+        float this_dist = dist2(p, (c)->pos) - (c)->radius; \
+        if (this_dist < dist) { dist = this_dist; if (hit) *hit = (c); } \
+    }
+    for (TerrainCirc *c = ter->circs + lo; (c - ter->circs) < ter->ncirc; c++) {
+        if (c->pos.x - p.x - ter->max_radius > dist) break;
+        VISIT(c);
+    }
+    for (TerrainCirc *c = ter->circs + lo - 1; c >= ter->circs; c--) {
+        if (p.x - c->pos.x - ter->max_radius > dist) break;
+        VISIT(c);
+    }
+#undef VISIT
+
+    return dist;
+}
+
+static uint32_t fnv1a(void *data, size_t len) {
+    uint32_t hash = 2166136261u;
+    uint8_t *bytes = data;
+    for (size_t i = 0; i < len; i++)
+        hash = (hash ^ bytes[i]) * 16777619u;
+    return hash;
+}
+static uint32_t terrain_hash(Terrain *ter) {
+    return fnv1a(ter->circs, sizeof(TerrainCirc) * ter->ncirc);
 }
 
-static void waffle_update(Waffle *waffle) {
-    Ent *attacker = edx_deref(waffle->attacker);
+/* where the grid goes for the current circles, with the margin around them */
+static TerrainSdfHeader terrain_sdf_header(Terrain *ter) {
+    Vec2 min = vec2(0.0f, 0.0f), max = vec2(0.0f, 0.0f);
+    for (TerrainCirc *c = ter->circs; (c - ter->circs) < ter->ncirc; c++) {
+        if (c == ter->circs) min = max = c->pos;
+        min.x = fminf(min.x, c->pos.x - c->radius), max.x = fmaxf(max.x, c->pos.x + c->radius),
+        min.y = fminf(min.y, c->pos.y - c->radius), max.y = fmaxf(max.y, c->pos.y + c->radius);
+    }
+    return (TerrainSdfHeader) {
+        .magic = "TSDF",
+        .version = TERRAIN_SDF_VERSION,
+        .map_hash = terrain_hash(ter),
+        .origin_x = min.x - TERRAIN_SDF_MARGIN,
+        .origin_y = min.y - TERRAIN_SDF_MARGIN,
+        .cell = TERRAIN_SDF_CELL,
+        .w = 2 + (int)ceilf((max.x - min.x + TERRAIN_SDF_MARGIN*2.0f) / TERRAIN_SDF_CELL),
+        .h = 2 + (int)ceilf((max.y - min.y + TERRAIN_SDF_MARGIN*2.0f) / TERRAIN_SDF_CELL),
+    };
+}
 
-    if (state.player->gen > 0) return;
+static Vec2 terrain_sdf_node(TerrainSdf *sdf, int x, int y) {
+    return add2(sdf->origin, vec2(x * TERRAIN_SDF_CELL, y * TERRAIN_SDF_CELL));
+}
 
-    SYSTEM(e) {
-        if (!e->hostile || e == attacker) continue;
+static void terrain_sdf_save(Terrain *ter, const char *path) {
+    TerrainSdf *sdf = &ter->sdf;
+    TerrainSdfHeader head = terrain_sdf_header(ter);
+    FILE *f;
+    if (!path) return;
+    if (!(f = fopen(path, "wb"))) { perror("couldn't cache terrain sdf"); return; }
+    fwrite(&head, sizeof(head), 1, f);
+    fwrite(sdf->dist, sizeof(float), sdf->w * sdf->h, f);
+    fclose(f);
+}
 
-        if (dist2(e->pos, state.player->pos) < 5.0f)
-            e->aggroed = 1;
+static void terrain_sdf_init(Terrain *ter, const char *path, Arena *a) {
+    TerrainSdf *sdf = &ter->sdf;
 
-        if (!e->aggroed) continue;
+    /* with nothing to be near, every node would be infinite and lerping them
+     * gives NaN; an empty grid covers nothing, so the analytic query answers */
+    if (!ter->ncirc) {
+        *sdf = (TerrainSdf) {0};
+        return;
+    }
 
-        /* find the closest slot */
-        Vec2 close_slot;
-        int close_slot_i;
-        float slot_dist = 20.0f;
-        for (int i = 0; i < WAFFLE_NSLOT; i++) {
-            Ent *slot_e = edx_deref(waffle->slots[i]);
-            if (slot_e && slot_e != e) continue;
+    TerrainSdfHeader want = terrain_sdf_header(ter), got = {0};
+    sdf->origin = vec2(want.origin_x, want.origin_y);
+    sdf->w = want.w;
+    sdf->h = want.h;
+    sdf->dist = ARENA_ARRAY(a, float, sdf->w * sdf->h);
+
+    FILE *f = path ? fopen(path, "rb") : NULL;
+    if (f) {
+        int ok = fread(&got, sizeof(got), 1, f) == 1 &&
+                 !memcmp(&got, &want, sizeof(got)) &&
+                 fread(sdf->dist, sizeof(float), sdf->w * sdf->h, f) == sdf->w * sdf->h;
+        fclose(f);
+        if (ok) return;
+    }
 
-            Vec2 slot_pos = waffle_slot_pos(i);
-            float to_slot = dist2(slot_pos, e->pos);
-            if (to_slot < slot_dist)
-                slot_dist = to_slot,
-                close_slot = slot_pos,
-                close_slot_i = i;
+    for (int y = 0; y < sdf->h; y++)
+        for (int x = 0; x < sdf->w; x++)
+            sdf->dist[y * sdf->w + x] = terrain_distance(ter, terrain_sdf_node(sdf, x, y), NULL);
+
+    terrain_sdf_save(ter, path);
+}
+
+/* ter's circles have already been swapped for the new ones; old is the grid baked
+ * for the previous set, which is copied into a. if it still covers the same area,
+ * only the samples whose nearest circle is gone need a real query; the rest can
+ * only have gotten closer, to one of the added circles */
+static void terrain_sdf_patch(
+    Terrain *ter, TerrainSdf old,
+    TerrainCirc *gone, int ngone,
+    TerrainCirc *added, int nadded,
+    const char *path, Arena *a
+) {
+    TerrainSdfHeader want = terrain_sdf_header(ter);
+    if (want.origin_x != old.origin.x || want.origin_y != old.origin.y ||
+        want.w != old.w || want.h != old.h) {
+        terrain_sdf_init(ter, path, a);
+        return;
+    }
+
+    TerrainSdf *sdf = &ter->sdf;
+    *sdf = old;
+    sdf->dist = ARENA_ARRAY(a, float, sdf->w * sdf->h);
+    memcpy(sdf->dist, old.dist, sizeof(float) * sdf->w * sdf->h);
+    if (!ngone && !nadded) return;
+
+    for (int y = 0; y < sdf->h; y++)
+        for (int x = 0; x < sdf->w; x++) {
+            Vec2 p = terrain_sdf_node(sdf, x, y);
+            float *d = sdf->dist + y * sdf->w + x;
+
+            int stale = 0;
+            for (TerrainCirc *c = gone; (c - gone) < ngone; c++)
+                stale |= fabsf(dist2(p, c->pos) - c->radius - *d) < 1e-5f;
+            if (stale) {
+                *d = terrain_distance(ter, p, NULL);
+                continue;
+            }
+            for (TerrainCirc *c = added; (c - added) < nadded; c++)
+                *d = fminf(*d, dist2(p, c->pos) - c->radius);
         }
 
+    terrain_sdf_save(ter, path);
+}
+
+static int terrain_sdf_sample(TerrainSdf *sdf, Vec2 p, float *out) {
+    float fx = (p.x - sdf->origin.x) / TERRAIN_SDF_CELL,
+          fy = (p.y - sdf->origin.y) / TERRAIN_SDF_CELL;
+    if (!(fx >= 0.0f && fy >= 0.0f && fx < sdf->w - 1 && fy < sdf->h - 1)) return 0;
+
+    int x = fx, y = fy;
+    float tx = fx - x, ty = fy - y;
+    float *d = sdf->dist + y * sdf->w + x;
+    float bot = d[0]      + (d[1]          - d[0])      * tx,
+          top = d[sdf->w] + (d[sdf->w + 1] - d[sdf->w]) * tx;
+    *out = bot + (top - bot) * ty;
+    return 1;
+}
+
+/* terrain distance from the baked grid where it covers p, analytic elsewhere.
+ * normal points from the nearest terrain surface toward p */
+static float terrain_distance_baked(Terrain *ter, Vec2 p, Vec2 *normal) {
+    float d;
+    if (!terrain_sdf_sample(&ter->sdf, p, &d)) {
+        TerrainCirc *c;
+        d = terrain_distance(ter, p, &c);
+        if (normal && d < POS_INF_F) *normal = norm2(sub2(p, c->pos));
+        return d;
+    }
+
+    if (normal) {
+        float e = TERRAIN_SDF_CELL * 0.5f, l, r, b, t;
+        if (terrain_sdf_sample(&ter->sdf, add2(p, vec2(-e, 0.0f)), &l) &&
+            terrain_sdf_sample(&ter->sdf, add2(p, vec2( e, 0.0f)), &r) &&
+            terrain_sdf_sample(&ter->sdf, add2(p, vec2(0.0f, -e)), &b) &&
+            terrain_sdf_sample(&ter->sdf, add2(p, vec2(0.0f,  e)), &t))
+            *normal = norm2(vec2(r - l, t - b));
+        else
+            terrain_distance_baked(ter, add2(p, vec2(e, e)), normal);
+    }
+    return d - TERRAIN_SDF_SLACK;
+}
+
+/* neighbor offsets, laid out so that the opposite of i is always i^1 */
+static const int nav_nbr_x[8] = { 1, -1, 0,  0, 1, -1,  1, -1 };
+static const int nav_nbr_y[8] = { 0,  0, 1, -1, 1, -1, -1,  1 };
+#define NAV_DIR_GOAL (9)
+
+static void nav_grid_init(NavGrid *nav, MapData *md) {
+    float margin = 8.0f;
+    Vec2 min = vec2( POS_INF_F,  POS_INF_F),
+         max = vec2(-POS_INF_F, -POS_INF_F);
+    for (MapData_Circle *c = md->circles; (c - md->circles) < md->ncircles; c++)
+        min.x = fminf(min.x, c->x - c->radius), max.x = fmaxf(max.x, c->x + c->radius),
+        min.y = fminf(min.y, c->y - c->radius), max.y = fmaxf(max.y, c->y + c->radius);
+    for (MapData_Tree *t = md->trees; (t - md->trees) < md->ntrees; t++)
+        min.x = fminf(min.x, t->x), max.x = fmaxf(max.x, t->x),
+        min.y = fminf(min.y, t->y), max.y = fmaxf(max.y, t->y);
+    if (min.x > max.x) min = max = vec2(0.0f, 0.0f);
+
+    nav->origin = sub2(min, vec2(margin, margin));
+    nav->w = (int)ceilf((max.x - min.x + margin*2.0f) / NAV_CELL);
+    nav->h = (int)ceilf((max.y - min.y + margin*2.0f) / NAV_CELL);
+    if (nav->w > NAV_MAX_W || nav->h > NAV_MAX_H)
+        printf("map is %dx%d nav cells, clamping to %dx%d\n", nav->w, nav->h, NAV_MAX_W, NAV_MAX_H),
+        nav->w = fminf(nav->w, NAV_MAX_W),
+        nav->h = fminf(nav->h, NAV_MAX_H);
+
+    nav->gen++;
+    memset(nav->blocked, 0, sizeof(nav->blocked));
+    for (MapData_Circle *c = md->circles; (c - md->circles) < md->ncircles; c++) {
+        float r = c->radius + NAV_AGENT_RADIUS;
+        int x0 = fmaxf(0.0f,   floorf((c->x - r - nav->origin.x) / NAV_CELL)),
+            y0 = fmaxf(0.0f,   floorf((c->y - r - nav->origin.y) / NAV_CELL)),
+            x1 = fminf(nav->w, ceilf ((c->x + r - nav->origin.x) / NAV_CELL)),
+            y1 = fminf(nav->h, ceilf ((c->y + r - nav->origin.y) / NAV_CELL));
+        for (int y = y0; y < y1; y++)
+            for (int x = x0; x < x1; x++) {
+                Vec2 center = add2(nav->origin, vec2((x + 0.5f) * NAV_CELL, (y + 0.5f) * NAV_CELL));
+                if (dist2(center, vec2(c->x, c->y)) < r)
+                    nav->blocked[y * nav->w + x] = 1;
+            }
+    }
+}
+
+static int nav_cell(NavGrid *nav, Vec2 p) {
+    int x = (int)floorf((p.x - nav->origin.x) / NAV_CELL),
+        y = (int)floorf((p.y - nav->origin.y) / NAV_CELL);
+    if (x < 0 || y < 0 || x >= nav->w || y >= nav->h) return -1;
+    return y * nav->w + x;
+}
+
+static void flow_advance(World *w, FlowField *ff, NavGrid *nav, Vec2 goal_pos) {
+    if (ff->advanced == w->tick) return;
+    ff->advanced = w->tick;
+
+    int goal = nav_cell(nav, goal_pos);
+    if (goal != ff->goal || ff->gen != nav->gen) {
+        ff->goal = goal;
+        ff->gen = nav->gen;
+        ff->head = ff->tail = 0;
+        memset(ff->dir, 0, sizeof(ff->dir));
+        if (goal < 0) return;
+        ff->dir[goal] = NAV_DIR_GOAL;
+        ff->queue[ff->tail++] = goal;
+    }
+
+    for (int n = 0; n < FLOW_BUDGET && ff->head < ff->tail; n++) {
+        int c = ff->queue[ff->head++];
+        int cx = c % nav->w, cy = c / nav->w;
+
+        for (int i = 0; i < 8; i++) {
+            int nx = cx + nav_nbr_x[i],
+                ny = cy + nav_nbr_y[i];
+            if (nx < 0 || ny < 0 || nx >= nav->w || ny >= nav->h) continue;
+
+            int nc = ny * nav->w + nx;
+            if (ff->dir[nc]) continue;
+
+            /* no cutting corners */
+            if (i >= 4 && (nav->blocked[cy * nav->w + nx] || nav->blocked[ny * nav->w + cx]))
+                continue;
+
+            /* blocked cells learn the way out, but the flow only goes
+             * through them to escape a goal that's inside of a collider */
+            ff->dir[nc] = 1 + (i ^ 1);
+            if (!nav->blocked[nc] || nav->blocked[c]) ff->queue[ff->tail++] = nc;
+        }
+    }
+}
+
+/* unit vector pointing the way from `from` to `goal` around the terrain */
+static Vec2 flow_steer(World *w, FlowField *ff, NavGrid *nav, Vec2 from, Vec2 goal) {
+    flow_advance(w, ff, nav, goal);
+
+    int c = nav_cell(nav, from);
+    if (c < 0 || ff->dir[c] == 0 || ff->dir[c] == NAV_DIR_GOAL)
+        return norm2(sub2(goal, from));
+
+    int i = ff->dir[c] - 1;
+    Vec2 next = add2(nav->origin, vec2(
+        (c % nav->w + nav_nbr_x[i] + 0.5f) * NAV_CELL,
+        (c / nav->w + nav_nbr_y[i] + 0.5f) * NAV_CELL
+    ));
+    return norm2(sub2(next, from));
+}
+
+/* simulation level of detail, by distance from the player: near ents are
+ * stepped every tick, mid-range ones every SIM_MID_STRIDE ticks by that many
+ * ticks' worth, and far ones sleep until sim_retier finds them nearer */
+#define SIM_NEAR (24.0f) /* the view is 11.8 across either way at the default zoom */
+#define SIM_FAR  (48.0f)
+#define SIM_MID_STRIDE (4)
+
+/* a word of the pool a tick, so no ent's tier is more than ENT_WORDS ticks old */
+static void sim_retier(World *w) {
+    int word = w->tick % ENT_WORDS;
+    for (uint64_t bits = ent_query_word(w, COMP(Active), word); bits; bits &= bits - 1) {
+        Ent *e = w->ents + word*64 + __builtin_ctzll(bits);
+        float d = dist2(e->pos, w->player->pos);
+        ent_comp_set(w, e, EntComp_Awake, d < SIM_FAR);
+        ent_comp_set(w, e, EntComp_Coarse, d >= SIM_NEAR && d < SIM_FAR);
+    }
+}
+/* how many ticks' worth an awake ent is stepped by this tick; mid-range ones
+ * are staggered by pool index so the same few don't all land on one tick */
+static int sim_steps(World *w, Ent *e) {
+    if (!ent_has(w, e, COMP(Coarse))) return 1;
+    return ((w->tick + (e - w->ents)) % SIM_MID_STRIDE) ? 0 : SIM_MID_STRIDE;
+}
+
+static Vec2 waffle_slot_pos(World *w, int slot_i) {
+    float angle = ((float)slot_i / (float)WAFFLE_NSLOT) * M_PI * 2.0f;
+    return add2(w->player->pos, mul2f(rads2(angle), 2.0f));
+}
+
+static void waffle_update(World *w) {
+    Waffle *waffle = &w->waffle;
+    Ent *attacker = edx_deref(w, waffle->attacker);
+
+    if (w->player->gen > 0) return;
+
+    /* searching for the closest slot is rationed to WAFFLE_SEARCHES a tick,
+     * taken in turns by pool index. between turns, ents head for the slot they
+     * last found, unless someone else has claimed it in the meantime */
+    int searches = WAFFLE_SEARCHES, search_from = waffle->search_from;
+    waffle->search_from = 0; /* unless the ration runs out before the end */
+
+    QUERY(w, e, COMP(Hostile) | COMP(Aggroed) | COMP(Awake)) {
+        if (e == attacker) continue;
+        int steps = sim_steps(w, e);
+        if (!steps) continue;
+
+        if (e->waffle_slot && e->waffle_slot != WAFFLE_NO_SLOT) {
+            Ent *slot_e = edx_deref(w, waffle->slots[e->waffle_slot - 1]);
+            if (slot_e && slot_e != e) e->waffle_slot = 0;
+        }
+        if (searches && (!e->waffle_slot || (e - w->ents) >= search_from)) {
+            if (!--searches) waffle->search_from = (e - w->ents) + 1;
+
+            e->waffle_slot = WAFFLE_NO_SLOT;
+            float slot_dist = WAFFLE_SLOT_REACH;
+            for (int i = 0; i < WAFFLE_NSLOT; i++) {
+                Ent *slot_e = edx_deref(w, waffle->slots[i]);
+                if (slot_e && slot_e != e) continue;
+
+                float to_slot = dist2(waffle_slot_pos(w, i), e->pos);
+                if (to_slot < slot_dist)
+                    slot_dist = to_slot,
+                    e->waffle_slot = i + 1;
+            }
+        }
+        if (!e->waffle_slot || e->waffle_slot == WAFFLE_NO_SLOT) continue;
+
+        int slot_i = e->waffle_slot - 1;
+        Vec2 slot_pos = waffle_slot_pos(w, slot_i);
+        float slot_dist = dist2(slot_pos, e->pos);
+
         /* be propelled toward it */
-        if (slot_dist > 0.1f && slot_dist < 20.0f) {
-            Vec2 delta = sub2(close_slot, e->pos);
-            float del_mag = mag2(delta);
-            float speed = fminf(del_mag, ent_speed(e) * 0.9f);
-            delta = div2f(delta, del_mag);
-            e->vel = add2(e->vel, mul2f(delta, speed));
+        if (slot_dist > 0.1f && slot_dist < WAFFLE_SLOT_REACH) {
+            FlowField *ff = waffle->flow + slot_i;
+            Vec2 delta = flow_steer(w, ff, &w->level->nav, e->pos, slot_pos);
+            float speed = fminf(slot_dist, ent_speed(e) * 0.9f * steps);
+            ent_push(w, e, mul2f(delta, speed));
             e->swing.toward = delta;
         }
 
         /* claim it if you're close enough */
         if (slot_dist < WAFFLE_SLOT_OCCUPANCY_DIST) {
-            waffle->slots[close_slot_i] = edx_from(e);
-            e->swing.toward = norm2(sub2(state.player->pos, e->pos));
+            waffle->slots[slot_i] = edx_from(w, e);
+            e->swing.toward = norm2(sub2(w->player->pos, e->pos));
         }
     }
 
     int attacker_slot_i = 0;
     for (int i = 0; i < WAFFLE_NSLOT; i++) {
-        Ent *slot_e = edx_deref(waffle->slots[i]);
+        Ent *slot_e = edx_deref(w, waffle->slots[i]);
         if (!slot_e) continue;
         if (slot_e == attacker) { attacker_slot_i = i; continue; }
 
         /* unclaim slots with distant owners */
-        if (dist2(slot_e->pos, waffle_slot_pos(i)) > WAFFLE_SLOT_OCCUPANCY_DIST) {
+        if (dist2(slot_e->pos, waffle_slot_pos(w, i)) > WAFFLE_SLOT_OCCUPANCY_DIST) {
             waffle->slots[i] = (Edx) {0};
             continue;
         }
 
         /* if nobody is attacking yet, well shucks, guess I oughta! */
         if (!attacker) {
-            waffle->attacker = edx_from(slot_e);
+            waffle->attacker = edx_from(w, slot_e);
             attacker = slot_e;
-            slot_e->swing.end = state.tick + item_attack_duration[slot_e->item];
+            ent_swing_until(w, slot_e, w->tick + item_attack_duration[slot_e->item]);
         }
     }
 
     if (attacker) {
-        if (state.tick > attacker->swing.end)
+        if (!ent_has(w, attacker, COMP(Swinging)))
             waffle->attacker = (Edx) {0};
         else {
-            Vec2 slot_pos = waffle_slot_pos(attacker_slot_i);
-            Vec2 goal = lerp2(state.player->pos, slot_pos, 0.6f);
+            Vec2 slot_pos = waffle_slot_pos(w, attacker_slot_i);
+            Vec2 goal = lerp2(w->player->pos, slot_pos, 0.6f);
 
             Vec2 delta = sub2(goal, attacker->pos);
             float delta_mag = mag2(delta);
             delta = div2f(delta, delta_mag);
 
             float speed = 0.005f * fminf(delta_mag, 1.00f);
-            attacker->vel = add2(attacker->vel, mul2f(delta, speed));
+            ent_push(w, attacker, mul2f(delta, speed));
         }
     }
 }
 
+/* an empty world on `level`, but for the player */
+static void world_init(World *w, Level *level) {
+    memset(w, 0, sizeof(*w));
+    w->level = level;
+    timers_init(w);
+    for (int i = 0; i < WAFFLE_NSLOT; i++)
+        w->waffle.flow[i].goal = -1;
+    w->player = ent_spawn_player(w);
+}
 
-stbtt_bakedchar cdata[96]; // ASCII 32..126 is 95 glyphs
+/* snapshots are only used by the bench so far; it #defines SNAPSHOTS before
+ * including this, and everything else goes without them */
+#ifdef SNAPSHOTS
+
+/* bits, least significant first, into a byte buffer. running off the end
+ * is sticky and checked once at the end instead of on every write */
+typedef struct { uint8_t *at, *end; uint64_t acc; int nacc, overflow; } BitWtr;
+typedef struct { const uint8_t *at, *end; uint64_t acc; int nacc, overflow; } BitRdr;
+
+static void bits_put(BitWtr *bw, uint32_t v, int n) {
+    bw->acc |= (uint64_t)((n == 32) ? v : (v & ((1u << n) - 1))) << bw->nacc;
+    bw->nacc += n;
+    for (; bw->nacc >= 8; bw->acc >>= 8, bw->nacc -= 8) {
+        if (bw->at < bw->end) *bw->at++ = bw->acc;
+        else bw->overflow = 1;
+    }
+}
+static uint32_t bits_get(BitRdr *br, int n) {
+    for (; br->nacc < n; br->nacc += 8) {
+        if (br->at < br->end) br->acc |= (uint64_t)*br->at++ << br->nacc;
+        else br->overflow = 1;
+    }
+    uint32_t v = (n == 32) ? (uint32_t)br->acc : (br->acc & ((1u << n) - 1));
+    br->acc >>= n, br->nacc -= n;
+    return v;
+}
+
+/* small numbers in few bits: a 2 bit width class, then the value */
+static const int bits_var_width[4] = { 3, 6, 12, 32 };
+static void bits_put_var(BitWtr *bw, uint32_t v) {
+    int c = (v < (1u << 3)) ? 0 : (v < (1u << 6)) ? 1 : (v < (1u << 12)) ? 2 : 3;
+    bits_put(bw, c, 2);
+    bits_put(bw, v, bits_var_width[c]);
+}
+static uint32_t bits_get_var(BitRdr *br) {
+    return bits_get(br, bits_var_width[bits_get(br, 2)]);
+}
+/* signed, zigzagged so small negatives stay small */
+static void bits_put_svar(BitWtr *bw, int32_t v) {
+    bits_put_var(bw, ((uint32_t)v << 1) ^ (uint32_t)(v >> 31));
+}
+static int32_t bits_get_svar(BitRdr *br) {
+    uint32_t v = bits_get_var(br);
+    return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+/* a World's ents and projectiles, quantized to what goes over the wire, so
+ * that a snapshot decodes to exactly what was encoded. damage labels and flow
+ * fields are left out; they're cosmetic or rebuilt on demand */
+#define SNAP_POS_SCALE (256.0f)  /* 1/256th of a unit, +-4M units in 32 bits */
+#define SNAP_VEL_SCALE (4096.0f) /* +-8 units a tick in 16 bits */
+#define SNAP_RADIUS_SCALE (128.0f)
+/* worst case: every slot spawned with every field at full width */
+#define SNAP_MAX_BYTES (ENT_MAX * 40 + PROJ_MAX * 20 + 128)
+
+typedef enum {
+    SnapGroup_Pos    = (1 << 0),
+    SnapGroup_Vel    = (1 << 1),
+    SnapGroup_Combat = (1 << 2), /* hp, last_damaged */
+    SnapGroup_Swing  = (1 << 3),
+    SnapGroup_Kind   = (1 << 4), /* looks, item, masks, flags, radius, friction */
+    SnapGroup_ALL    = (1 << 5) - 1,
+} SnapGroup;
+
+typedef enum {
+    SnapEntFlag_Hostile = (1 << 0),
+    SnapEntFlag_Aggroed = (1 << 1),
+} SnapEntFlag;
+
+typedef struct {
+    uint32_t gen;
+    uint8_t active;
+
+    int32_t pos[2];
+    int16_t vel[2];
+
+    uint8_t hp;
+    uint32_t last_damaged; /* ticks wrap at 2^32 on the wire */
+
+    uint32_t swing_end;
+    uint8_t swing_toward; /* an angle, in 256ths of a turn */
+    uint8_t swing_shot;
+
+    uint8_t looks, item, flags;
+    uint8_t has_mask, hit_mask, item_hit_mask; /* just the EntMask bits */
+    uint8_t radius, friction;
+} SnapEnt;
+
+/* laid out without padding, so it can be memcmp'd */
+typedef struct {
+    Edx waffle_slots[WAFFLE_NSLOT], waffle_attacker;
+    uint16_t player; /* slot + 1, 0 for none */
+    uint16_t aimer_active;
+    int32_t aimer_pos[2];
+} SnapHead;
+
+/* projectiles have no identity to diff against, and they're
+ * small and short lived, so they're always sent whole */
+typedef struct {
+    int32_t pos[2];
+    int16_t vel[2];
+    Edx owner;
+    uint8_t hit_mask;
+} SnapProj;
+
+typedef struct {
+    uint32_t tick;
+    SnapHead head;
+    SnapEnt ents[ENT_MAX];
+    int nproj;
+    SnapProj projs[PROJ_MAX];
+} Snap;
+
+typedef enum {
+    SnapOp_Delta,   /* same ent as in the base, some groups changed */
+    SnapOp_Spawn,   /* an ent the base didn't have in this slot, or had at another gen */
+    SnapOp_Despawn,
+    SnapOp_End,
+} SnapOp;
+
+static int16_t snap_q16(float v, float scale) {
+    return fmaxf(fminf(roundf(v * scale), INT16_MAX), INT16_MIN);
+}
+/* positions; the clamp keeps differences between two of them in an int32 */
+static int32_t snap_q_pos(float v) {
+    return fmax(fmin(round((double)v * SNAP_POS_SCALE), 1 << 30), -(1 << 30));
+}
+/* dangling handles go out as none, so the receiver never has to guess at gens */
+static Edx snap_edx(World *w, Edx edx) {
+    return edx_deref(w, edx) ? edx : (Edx) {0};
+}
+
+static void snap_take(World *w, Snap *s) {
+    s->tick = w->tick;
+    s->head = (SnapHead) {
+        .waffle_attacker = snap_edx(w, w->waffle.attacker),
+        .player = w->player ? (w->player - w->ents) + 1 : 0,
+        .aimer_active = w->aimer.active,
+        .aimer_pos = {
+            snap_q_pos(w->aimer.pos.x),
+            snap_q_pos(w->aimer.pos.y)
+        },
+    };
+    for (int i = 0; i < WAFFLE_NSLOT; i++)
+        s->head.waffle_slots[i] = snap_edx(w, w->waffle.slots[i]);
+
+    s->nproj = w->nproj;
+    for (int i = 0; i < w->nproj; i++) {
+        Proj *p = w->projs + i;
+        s->projs[i] = (SnapProj) {
+            .pos = { snap_q_pos(p->pos.x), snap_q_pos(p->pos.y) },
+            .vel = { snap_q16(p->vel.x, SNAP_VEL_SCALE), snap_q16(p->vel.y, SNAP_VEL_SCALE) },
+            .owner = snap_edx(w, p->owner),
+            .hit_mask = p->hit_mask & 7,
+        };
+    }
+
+    memset(s->ents, 0, sizeof(s->ents));
+    SYSTEM(w, e) {
+        float toward = vec2_rads(e->swing.toward) / (M_PI * 2.0f) * 256.0f;
+        s->ents[e - w->ents] = (SnapEnt) {
+            .gen = e->gen,
+            .active = 1,
+            .pos = { snap_q_pos(e->pos.x), snap_q_pos(e->pos.y) },
+            .vel = { snap_q16(e->vel.x, SNAP_VEL_SCALE), snap_q16(e->vel.y, SNAP_VEL_SCALE) },
+            .hp = e->hp,
+            .last_damaged = e->last_damaged,
+            .swing_end = e->swing.end,
+            .swing_toward = (int)roundf(toward) & 255,
+            .swing_shot = e->swing.shot,
+            .looks = e->looks,
+            .item = e->item,
+            .flags = (ent_has(w, e, COMP(Hostile)) ? SnapEntFlag_Hostile : 0) |
+                     (ent_has(w, e, COMP(Aggroed)) ? SnapEntFlag_Aggroed : 0),
+            .has_mask = e->has_mask & 7,
+            .hit_mask = e->hit_mask & 7,
+            .item_hit_mask = e->item_hit_mask & 7,
+            .radius = fminf(roundf(e->radius * SNAP_RADIUS_SCALE), 255.0f),
+            .friction = fminf(roundf(e->friction * 255.0f), 255.0f),
+        };
+    }
+}
+
+/* replaces w's ents and waffle with the snapshot's */
+static void snap_apply(World *w, Snap *s) {
+    w->tick = s->tick;
+    memset(w->comps, 0, sizeof(w->comps));
+    timers_init(w);
+    for (int i = 0; i < DMG_LBL_MAX; i++)
+        w->dmg_lbls[i].timer = 0,
+        w->dmg_lbls[i].tick = 0;
+    for (int i = 0; i < ENT_MAX; i++) {
+        SnapEnt *q = s->ents + i;
+        Ent *e = w->ents + i;
+        if (!q->active) { e->active = 0, memset(e->timers, 0, sizeof(e->timers)); continue; }
+
+        *e = (Ent) {
+            .active = 1,
+            .gen = q->gen,
+            .last_damaged = q->last_damaged,
+            .hp = q->hp,
+            .radius = q->radius / SNAP_RADIUS_SCALE,
+            .friction = q->friction / 255.0f,
+            .hit_mask = q->hit_mask,
+            .item_hit_mask = q->item_hit_mask,
+            .pos = vec2(q->pos[0] / SNAP_POS_SCALE, q->pos[1] / SNAP_POS_SCALE),
+            .vel = vec2(q->vel[0] / SNAP_VEL_SCALE, q->vel[1] / SNAP_VEL_SCALE),
+            .swing = {
+                .end = q->swing_end,
+                .toward = rads2(q->swing_toward / 256.0f * M_PI * 2.0f),
+                .shot = q->swing_shot,
+            },
+        };
+        ent_comp_set(w, e, EntComp_Active, 1);
+        ent_comp_set(w, e, EntComp_Awake, 1);
+        ent_set_looks(w, e, q->looks);
+        ent_set_item(w, e, q->item);
+        ent_set_has_mask(w, e, q->has_mask);
+        ent_set_hostile(w, e, q->flags & SnapEntFlag_Hostile);
+        ent_comp_set(w, e, EntComp_Aggroed, q->flags & SnapEntFlag_Aggroed);
+        if (w->tick <= e->swing.end) ent_swing_until(w, e, e->swing.end);
+        ent_comp_set(w, e, EntComp_Moving, q->vel[0] || q->vel[1]);
+    }
+
+    for (int i = 0; i < WAFFLE_NSLOT; i++)
+        w->waffle.slots[i] = s->head.waffle_slots[i];
+    w->waffle.attacker = s->head.waffle_attacker;
+    w->player = s->head.player ? w->ents + s->head.player - 1 : NULL;
+    w->aimer.active = s->head.aimer_active;
+    w->aimer.pos = vec2(s->head.aimer_pos[0] / SNAP_POS_SCALE, s->head.aimer_pos[1] / SNAP_POS_SCALE);
+
+    w->nproj = s->nproj;
+    for (int i = 0; i < s->nproj; i++) {
+        SnapProj *q = s->projs + i;
+        w->projs[i] = (Proj) {
+            .pos = vec2(q->pos[0] / SNAP_POS_SCALE, q->pos[1] / SNAP_POS_SCALE),
+            .vel = vec2(q->vel[0] / SNAP_VEL_SCALE, q->vel[1] / SNAP_VEL_SCALE),
+            .owner = q->owner,
+            .hit_mask = q->hit_mask,
+        };
+    }
+}
+
+static SnapGroup snap_ent_changes(SnapEnt *a, SnapEnt *b) {
+    SnapGroup g = 0;
+    if (a->pos[0] != b->pos[0] || a->pos[1] != b->pos[1]) g |= SnapGroup_Pos;
+    if (a->vel[0] != b->vel[0] || a->vel[1] != b->vel[1]) g |= SnapGroup_Vel;
+    if (a->hp != b->hp || a->last_damaged != b->last_damaged) g |= SnapGroup_Combat;
+    if (a->swing_end != b->swing_end ||
+        a->swing_toward != b->swing_toward ||
+        a->swing_shot != b->swing_shot) g |= SnapGroup_Swing;
+    if (a->looks != b->looks || a->item != b->item || a->flags != b->flags ||
+        a->has_mask != b->has_mask || a->hit_mask != b->hit_mask ||
+        a->item_hit_mask != b->item_hit_mask ||
+        a->radius != b->radius || a->friction != b->friction) g |= SnapGroup_Kind;
+    return g;
+}
+
+/* numbers go out as differences from `old`, so still things cost nothing
+ * and slow things cost a few bits */
+static void snap_ent_put(BitWtr *bw, SnapEnt *old, SnapEnt *e, SnapGroup groups) {
+    if (groups & SnapGroup_Pos)
+        bits_put_svar(bw, e->pos[0] - old->pos[0]),
+        bits_put_svar(bw, e->pos[1] - old->pos[1]);
+    if (groups & SnapGroup_Vel)
+        bits_put_svar(bw, e->vel[0] - old->vel[0]),
+        bits_put_svar(bw, e->vel[1] - old->vel[1]);
+    if (groups & SnapGroup_Combat)
+        bits_put(bw, e->hp, 8),
+        bits_put_svar(bw, e->last_damaged - old->last_damaged);
+    if (groups & SnapGroup_Swing)
+        bits_put_svar(bw, e->swing_end - old->swing_end),
+        bits_put(bw, e->swing_toward, 8),
+        bits_put(bw, e->swing_shot, 1);
+    if (groups & SnapGroup_Kind)
+        bits_put(bw, e->looks, 2),
+        bits_put(bw, e->item, 2),
+        bits_put(bw, e->flags, 2),
+        bits_put(bw, e->has_mask, 3),
+        bits_put(bw, e->hit_mask, 3),
+        bits_put(bw, e->item_hit_mask, 3),
+        bits_put(bw, e->radius, 8),
+        bits_put(bw, e->friction, 8);
+}
+/* e starts out as a copy of old */
+static void snap_ent_get(BitRdr *br, SnapEnt *e, SnapGroup groups) {
+    if (groups & SnapGroup_Pos)
+        e->pos[0] += bits_get_svar(br),
+        e->pos[1] += bits_get_svar(br);
+    if (groups & SnapGroup_Vel)
+        e->vel[0] += bits_get_svar(br),
+        e->vel[1] += bits_get_svar(br);
+    if (groups & SnapGroup_Combat)
+        e->hp = bits_get(br, 8),
+        e->last_damaged += bits_get_svar(br);
+    if (groups & SnapGroup_Swing)
+        e->swing_end += bits_get_svar(br),
+        e->swing_toward = bits_get(br, 8),
+        e->swing_shot = bits_get(br, 1);
+    if (groups & SnapGroup_Kind)
+        e->looks = bits_get(br, 2),
+        e->item = bits_get(br, 2),
+        e->flags = bits_get(br, 2),
+        e->has_mask = bits_get(br, 3),
+        e->hit_mask = bits_get(br, 3),
+        e->item_hit_mask = bits_get(br, 3),
+        e->radius = bits_get(br, 8),
+        e->friction = bits_get(br, 8);
+}
+
+/* what a snapshot encoded without a base is a delta from */
+static Snap snap_none;
+
+/* writes s as a delta from base, which should be the last snapshot the
+ * receiver acknowledged (NULL to send everything). returns the bytes
+ * written, or 0 if they didn't fit in cap */
+static size_t snap_encode(Snap *base, Snap *s, uint8_t *buf, size_t cap) {
+    BitWtr bw = { .at = buf, .end = buf + cap };
+    bits_put(&bw, s->tick, 32);
+    bits_put(&bw, base != NULL, 1);
+    if (base) bits_put(&bw, base->tick, 32);
+    else base = &snap_none;
+
+    int head_changed = memcmp(&base->head, &s->head, sizeof(SnapHead)) != 0;
+    bits_put(&bw, head_changed, 1);
+    if (head_changed) {
+        SnapHead *h = &s->head;
+        for (int i = 0; i <= WAFFLE_NSLOT; i++) {
+            Edx edx = (i < WAFFLE_NSLOT) ? h->waffle_slots[i] : h->waffle_attacker;
+            bits_put(&bw, edx.idx, 11);
+            if (edx.idx) bits_put_var(&bw, edx.gen);
+        }
+        bits_put(&bw, h->player, 11);
+        bits_put(&bw, h->aimer_active, 1);
+        bits_put_svar(&bw, h->aimer_pos[0]);
+        bits_put_svar(&bw, h->aimer_pos[1]);
+    }
+
+    /* slots that haven't changed are skipped over, by count */
+    int next = 0;
+    for (int i = 0; i < ENT_MAX; i++) {
+        SnapEnt *old = base->ents + i, *e = s->ents + i;
+        if (!old->active && !e->active) continue;
+
+        SnapOp op;
+        SnapGroup groups = SnapGroup_ALL;
+        if (!e->active) op = SnapOp_Despawn;
+        else if (!old->active || old->gen != e->gen) op = SnapOp_Spawn;
+        else if ((groups = snap_ent_changes(old, e))) op = SnapOp_Delta;
+        else continue;
+
+        bits_put(&bw, op, 2);
+        bits_put_var(&bw, i - next);
+        next = i + 1;
+        if (op == SnapOp_Spawn) {
+            bits_put_var(&bw, e->gen);
+            snap_ent_put(&bw, &(SnapEnt) { .last_damaged = s->tick, .swing_end = s->tick }, e, groups);
+        }
+        if (op == SnapOp_Delta) {
+            bits_put(&bw, groups, 5);
+            snap_ent_put(&bw, old, e, groups);
+        }
+    }
+    bits_put(&bw, SnapOp_End, 2);
+
+    bits_put(&bw, s->nproj, 12);
+    for (SnapProj *p = s->projs; (p - s->projs) < s->nproj; p++) {
+        bits_put_svar(&bw, p->pos[0]);
+        bits_put_svar(&bw, p->pos[1]);
+        bits_put(&bw, p->vel[0], 16);
+        bits_put(&bw, p->vel[1], 16);
+        bits_put(&bw, p->hit_mask, 3);
+        bits_put(&bw, p->owner.idx, 11);
+        if (p->owner.idx) bits_put_var(&bw, p->owner.gen);
+    }
+    if (bw.nacc) bits_put(&bw, 0, 8 - bw.nacc);
+
+    return bw.overflow ? 0 : bw.at - buf;
+}
+
+/* reads a snapshot encoded against base into out (which mustn't be base).
+ * returns 0 if it's malformed or was encoded against some other base */
+static int snap_decode(Snap *base, Snap *out, const uint8_t *buf, size_t len) {
+    BitRdr br = { .at = buf, .end = buf + len };
+    uint32_t tick = bits_get(&br, 32);
+    int has_base = bits_get(&br, 1);
+    if (has_base != (base != NULL)) return 0;
+    if (base && bits_get(&br, 32) != base->tick) return 0;
+    if (!base) base = &snap_none;
+
+    memcpy(out, base, sizeof(Snap));
+    out->tick = tick;
+
+    if (bits_get(&br, 1)) {
+        SnapHead *h = &out->head;
+        for (int i = 0; i <= WAFFLE_NSLOT; i++) {
+            Edx *edx = (i < WAFFLE_NSLOT) ? h->waffle_slots + i : &h->waffle_attacker;
+            edx->idx = bits_get(&br, 11);
+            edx->gen = edx->idx ? bits_get_var(&br) : 0;
+            if (edx->idx > ENT_MAX) return 0;
+        }
+        h->player = bits_get(&br, 11);
+        h->aimer_active = bits_get(&br, 1);
+        h->aimer_pos[0] = bits_get_svar(&br);
+        h->aimer_pos[1] = bits_get_svar(&br);
+        if (h->player > ENT_MAX) return 0;
+    }
+
+    for (int i = 0;; i++) {
+        SnapOp op = bits_get(&br, 2);
+        if (op == SnapOp_End) break;
+
+        uint32_t skip = bits_get_var(&br);
+        if (br.overflow || skip >= ENT_MAX - i) return 0;
+        i += skip;
+        SnapEnt *e = out->ents + i;
+
+        switch (op) {
+        case SnapOp_Spawn: {
+            *e = (SnapEnt) { .active = 1, .last_damaged = tick, .swing_end = tick };
+            e->gen = bits_get_var(&br);
+            snap_ent_get(&br, e, SnapGroup_ALL);
+        } break;
+        case SnapOp_Delta: {
+            if (!e->active) return 0;
+            snap_ent_get(&br, e, bits_get(&br, 5));
+        } break;
+        case SnapOp_Despawn: {
+            if (!e->active) return 0;
+            *e = (SnapEnt) {0};
+        } break;
+        case SnapOp_End: break;
+        }
+    }
+
+    out->nproj = bits_get(&br, 12);
+    if (out->nproj > PROJ_MAX) return 0;
+    for (SnapProj *p = out->projs; (p - out->projs) < out->nproj; p++) {
+        p->pos[0] = bits_get_svar(&br);
+        p->pos[1] = bits_get_svar(&br);
+        p->vel[0] = bits_get(&br, 16);
+        p->vel[1] = bits_get(&br, 16);
+        p->hit_mask = bits_get(&br, 3);
+        p->owner.idx = bits_get(&br, 11);
+        p->owner.gen = p->owner.idx ? bits_get_var(&br) : 0;
+        if (p->owner.idx > ENT_MAX) return 0;
+    }
+    return !br.overflow;
+}
+
+#endif /* SNAPSHOTS */
+
+/* glyphs are rasterized into the atlas the first time they're written, at
+ * whatever size they're asked for, and packed in with stb_rect_pack. a glyph
+ * that doesn't fit is left blank for a frame: glyphs_flush() then drops every
+ * glyph that wasn't written that frame and repacks the rest with the missing
+ * ones. if one frame's text is more than the atlas holds, what's left over
+ * stays blank, and the atlas isn't repacked again for GLYPH_RETRY_FRAMES */
+#define FONT_PATH "./WackClubSans-Regular.ttf"
+#define TEXT_PX (24)
+#define GLYPH_MAX (1 << 10)
+#define GLYPH_BUCKETS (GLYPH_MAX * 2)
+#define GLYPH_PAD (1) /* texels between glyphs, so sampling one can't bleed into the next */
+#define GLYPH_MISSED_MAX (1 << 6)
+#define GLYPH_RETRY_FRAMES (60)
+typedef struct {
+    uint32_t codepoint;
+    uint16_t px;
+    uint16_t x0, y0, x1, y1; /* in the atlas */
+    int16_t xoff, yoff;
+    float xadvance;
+    uint32_t used; /* glyphs.frame it was last written in */
+} Glyph;
+static struct {
+    stbtt_fontinfo info;
+    uint8_t *ttf; size_t ttf_size;
+    uint8_t *pixels; /* GLYPH_ATLAS*GLYPH_ATLAS, in Mem_Font */
+    sg_image img; /* zero until load_poll() makes it, which is when glyphs get written */
+
+    stbrp_context packer;
+    stbrp_node nodes[GLYPH_ATLAS];
+    Glyph glyphs[GLYPH_MAX];
+    int nglyph;
+    uint16_t lookup[GLYPH_BUCKETS]; /* a glyph's index + 1, 0 if empty */
+
+    /* glyphs that didn't fit, to be added once there's room */
+    struct { uint32_t codepoint; uint16_t px; } missed[GLYPH_MISSED_MAX];
+    int nmissed;
+
+    uint32_t frame;
+    uint32_t retry; /* the first frame a full atlas may be repacked in */
+    uint8_t dirty; /* pixels has changed since it was last uploaded */
+    uint8_t full;  /* a glyph didn't fit, make room at the next glyphs_flush() */
+} glyphs;
+
+static uint32_t glyph_bucket(uint32_t codepoint, int px) {
+    return (codepoint * 2654435761u ^ px * 40503u) & (GLYPH_BUCKETS - 1);
+}
+
+/* the glyph goes where glyphs.lookup says, but its Glyph is up to the caller */
+static void glyph_insert(Glyph *g) {
+    uint32_t b = glyph_bucket(g->codepoint, g->px);
+    while (glyphs.lookup[b]) b = (b + 1) & (GLYPH_BUCKETS - 1);
+    glyphs.lookup[b] = g - glyphs.glyphs + 1;
+}
+
+/* empties the atlas down to the solid texel that untextured geometry samples */
+static void glyphs_clear(void) {
+    memset(glyphs.pixels, 0, GLYPH_ATLAS*GLYPH_ATLAS);
+    memset(glyphs.lookup, 0, sizeof(glyphs.lookup));
+    glyphs.nglyph = 0;
+    stbrp_init_target(&glyphs.packer, GLYPH_ATLAS, GLYPH_ATLAS, glyphs.nodes, GLYPH_ATLAS);
+
+    /* the first rect into an empty skyline always lands at (0,0) */
+    stbrp_rect solid = { .w = 1 + GLYPH_PAD, .h = 1 + GLYPH_PAD };
+    stbrp_pack_rects(&glyphs.packer, &solid, 1);
+    glyphs.pixels[0] = 255;
+    glyphs.dirty = 1;
+}
+
+static void glyph_miss(uint32_t codepoint, int px) {
+    glyphs.full = 1;
+    for (int i = 0; i < glyphs.nmissed; i++)
+        if (glyphs.missed[i].codepoint == codepoint && glyphs.missed[i].px == px) return;
+    if (glyphs.nmissed < GLYPH_MISSED_MAX)
+        glyphs.missed[glyphs.nmissed].codepoint = codepoint,
+        glyphs.missed[glyphs.nmissed++].px = px;
+}
+
+/* NULL if the atlas isn't up yet, or if the glyph doesn't fit */
+static Glyph *glyph_get(uint32_t codepoint, int px) {
+    if (!glyphs.img.id) return NULL;
+
+    uint32_t b = glyph_bucket(codepoint, px);
+    for (; glyphs.lookup[b]; b = (b + 1) & (GLYPH_BUCKETS - 1)) {
+        Glyph *g = glyphs.glyphs + glyphs.lookup[b] - 1;
+        if (g->codepoint == codepoint && g->px == px) {
+            g->used = glyphs.frame;
+            return g;
+        }
+    }
+    if (glyphs.full || glyphs.nglyph == GLYPH_MAX) {
+        glyph_miss(codepoint, px);
+        return NULL;
+    }
+
+    int idx = stbtt_FindGlyphIndex(&glyphs.info, codepoint);
+    float scale = stbtt_ScaleForPixelHeight(&glyphs.info, px);
+    int advance, lsb, x0, y0, x1, y1;
+    stbtt_GetGlyphHMetrics(&glyphs.info, idx, &advance, &lsb);
+    stbtt_GetGlyphBitmapBox(&glyphs.info, idx, scale, scale, &x0, &y0, &x1, &y1);
+    stbrp_rect r = { .w = x1 - x0 + GLYPH_PAD, .h = y1 - y0 + GLYPH_PAD };
+    stbrp_pack_rects(&glyphs.packer, &r, 1);
+    if (!r.was_packed) {
+        glyph_miss(codepoint, px);
+        return NULL;
+    }
+    size_t scratch = mem[Mem_Font].used;
+    stbtt_MakeGlyphBitmap(&glyphs.info, glyphs.pixels + r.y*GLYPH_ATLAS + r.x,
+                          x1 - x0, y1 - y0, GLYPH_ATLAS, scale, scale, idx);
+    mem[Mem_Font].used = scratch;
+    glyphs.dirty = 1;
+
+    Glyph *g = glyphs.glyphs + glyphs.nglyph++;
+    *g = (Glyph) {
+        .codepoint = codepoint,
+        .px = px,
+        .x0 = r.x, .y0 = r.y, .x1 = r.x + x1 - x0, .y1 = r.y + y1 - y0,
+        .xoff = x0, .yoff = y0,
+        .xadvance = scale * advance,
+        .used = glyphs.frame,
+    };
+    glyph_insert(g);
+    return g;
+}
+
+/* keeps the glyphs written this frame, repacked into an empty atlas,
+ * and adds the ones it went without */
+static void glyphs_evict(Arena *scratch) {
+    uint8_t *old = arena_push(scratch, GLYPH_ATLAS*GLYPH_ATLAS);
+    Glyph *old_glyphs = ARENA_ARRAY(scratch, Glyph, glyphs.nglyph);
+    stbrp_rect *rects = ARENA_ARRAY(scratch, stbrp_rect, glyphs.nglyph);
+    memcpy(old, glyphs.pixels, GLYPH_ATLAS*GLYPH_ATLAS);
+    memcpy(old_glyphs, glyphs.glyphs, sizeof(Glyph) * glyphs.nglyph);
+
+    int nrect = 0;
+    for (Glyph *g = old_glyphs; (g - old_glyphs) < glyphs.nglyph; g++)
+        if (g->used == glyphs.frame)
+            rects[nrect++] = (stbrp_rect) {
+                .id = g - old_glyphs,
+                .w = g->x1 - g->x0 + GLYPH_PAD,
+                .h = g->y1 - g->y0 + GLYPH_PAD
+            };
+
+    glyphs_clear();
+    stbrp_pack_rects(&glyphs.packer, rects, nrect);
+    for (stbrp_rect *r = rects; (r - rects) < nrect; r++) {
+        if (!r->was_packed) continue;
+        Glyph *g = glyphs.glyphs + glyphs.nglyph++;
+        *g = old_glyphs[r->id];
+        for (int y = 0; y < g->y1 - g->y0; y++)
+            memcpy(glyphs.pixels + (r->y + y)*GLYPH_ATLAS + r->x,
+                   old + (g->y0 + y)*GLYPH_ATLAS + g->x0, g->x1 - g->x0);
+        g->x1 = r->x + g->x1 - g->x0, g->x0 = r->x;
+        g->y1 = r->y + g->y1 - g->y0, g->y0 = r->y;
+        glyph_insert(g);
+    }
+
+    /* missing ones that still don't fit land back in glyphs.missed,
+     * always behind where this has read up to */
+    int nmissed = glyphs.nmissed;
+    glyphs.full = 0, glyphs.nmissed = 0;
+    for (int i = 0; i < nmissed; i++)
+        glyph_get(glyphs.missed[i].codepoint, glyphs.missed[i].px);
+    if (glyphs.full) glyphs.retry = glyphs.frame + GLYPH_RETRY_FRAMES;
+}
+
+/* once a frame, after all its text is written: sokol only takes whole images,
+ * so a frame that rasterized anything uploads the whole atlas */
+static void glyphs_flush(Arena *scratch) {
+    if (glyphs.dirty) {
+        sg_update_image(glyphs.img, &(sg_image_data) {
+            .subimage[0][0] = { glyphs.pixels, GLYPH_ATLAS*GLYPH_ATLAS }
+        });
+        glyphs.dirty = 0;
+    }
+    /* this frame's text is already written against where its glyphs are now,
+     * so they're only moved for the next one */
+    if (glyphs.full && (int32_t)(glyphs.frame - glyphs.retry) >= 0) glyphs_evict(scratch);
+    glyphs.frame++;
+}
+
+/* the codepoint at *s, stepping past it. malformed bytes come out as U+FFFD */
+static uint32_t utf8_next(char **s) {
+    uint8_t *p = (uint8_t *)*s;
+    uint32_t c = *p++;
+    int extra = c < 0x80 ? 0 : (c >> 5) == 0x6 ? 1 : (c >> 4) == 0xE ? 2 : (c >> 3) == 0x1E ? 3 : -1;
+    if (extra < 0) c = 0xFFFD, extra = 0;
+    else c &= 0x7F >> extra;
+    for (; extra; extra--, p++) {
+        if ((*p & 0xC0) != 0x80) {
+            c = 0xFFFD;
+            break;
+        }
+        c = (c << 6) | (*p & 0x3F);
+    }
+    *s = (char *)p;
+    return c;
+}
 
 #define PALETTE \
     X(Color_White,         1.00f, 1.00f, 1.00f, 1.00f) \
@@ -454,12 +2193,26 @@ stbtt_bakedchar cdata[96]; // ASCII 32..126 is 95 glyphs
 typedef enum { PALETTE } Color;
 #undef X
 
-#define GAME_SCALE (11.8f)
+#define GAME_SCALE (11.8f) /* the default zoom */
+/* pixels per world unit at the current zoom */
+static float view_scale(void) {
+    return sapp_widthf() / (state.zoom * 2.0f);
+}
+/* half the size of the world-space rectangle on screen, around state.cam */
+static Vec2 view_half_size(void) {
+    float ar = sapp_widthf() / sapp_heightf(); /* aspect ratio */
+    return vec2(state.zoom, state.zoom / ar);
+}
+/* whether anything within radius of p could be on screen; half is view_half_size() */
+static int view_overlaps(Vec2 half, Vec2 p, float radius) {
+    return fabsf(p.x - state.cam.x) < half.x + radius &&
+           fabsf(p.y - state.cam.y) < half.y + radius;
+}
 static Mat4 mvp4x4(void) {
     float f_range = 1.0f / (geo_max_z - geo_min_z);
 
-    float xx = 1.0f / GAME_SCALE;
-    float yy = sapp_widthf() / sapp_heightf() / GAME_SCALE;
+    float xx = 1.0f / state.zoom;
+    float yy = sapp_widthf() / sapp_heightf() / state.zoom;
     float zz = f_range;
     float zw = -f_range * geo_min_z;
     Mat4 res = {
@@ -480,22 +2233,27 @@ static Mat4 mvp4x4(void) {
     return res;
 }
 
-static int dmg_lbl_alive(DmgLbl *dl) {
-    return dl->tick && (state.tick - dl->tick) < 20;
+static Vec2 world_to_screen(Vec2 p) {
+    Vec4 p4 = mul4x44(mvp4x4(), (Vec4) {{ p.x, p.y, 0.0f, 1.0f }});
+    return mul2(vec2((p4.arr[0] + 1.0f) / 2.0f, (p4.arr[1] + 1.0f) / 2.0f),
+                vec2(sapp_widthf(), sapp_heightf()));
 }
 
-static void dmg_lbl_push(uint8_t hp, Vec2 world_pos, Ent *ent) {
-    Vec4 lbl_pos4 = mul4x44(mvp4x4(), (Vec4) {{ world_pos.x, world_pos.y, 0.0f, 1.0f }});
-    Vec2 pos = vec2((lbl_pos4.arr[0] + 1.0f) / 2.0f, (lbl_pos4.arr[1] + 1.0f) / 2.0f);
-    pos = mul2(pos, vec2(sapp_widthf(), sapp_heightf()));
+#define DMG_LBL_TICKS (20)
+static int dmg_lbl_alive(DmgLbl *dl) {
+    return dl->tick != 0; /* its timer zeroes it */
+}
 
+static void dmg_lbl_push(World *w, uint8_t hp, Vec2 pos, Ent *ent) {
     int oldest_i = -1;
-    Tick oldest_i_tick = state.tick;
-    for (int i = 0; i < sizeof(state.dmg_lbls) / sizeof(state.dmg_lbls[0]); i++) {
-        DmgLbl *dl = state.dmg_lbls + i;
-        if (dmg_lbl_alive(dl) && dl->ent == ent && dist2(dl->pos, pos) < 60.0f) {
+    Tick oldest_i_tick = w->tick;
+    for (int i = 0; i < sizeof(w->dmg_lbls) / sizeof(w->dmg_lbls[0]); i++) {
+        DmgLbl *dl = w->dmg_lbls + i;
+        /* about 60px at the default zoom */
+        if (dmg_lbl_alive(dl) && dl->ent == ent && dist2(dl->pos, pos) < 1.1f) {
             dl->hp += hp;
-            dl->tick = state.tick;
+            dl->tick = w->tick;
+            timer_arm(w, TimerKind_DmgLbl, (Edx) { .idx = i }, w->tick + DMG_LBL_TICKS);
             return;
         }
 
@@ -504,24 +2262,85 @@ static void dmg_lbl_push(uint8_t hp, Vec2 world_pos, Ent *ent) {
             oldest_i = i;
     }
 
-    if (oldest_i > -1)
-        state.dmg_lbls[oldest_i] = (DmgLbl) {
+    if (oldest_i > -1) {
+        w->dmg_lbls[oldest_i] = (DmgLbl) {
             .pos = pos,
             .hp = hp,
-            .tick = state.tick,
+            .tick = w->tick,
+            .timer = w->dmg_lbls[oldest_i].timer,
         };
+        timer_arm(w, TimerKind_DmgLbl, (Edx) { .idx = oldest_i }, w->tick + DMG_LBL_TICKS);
+    }
+}
+
+static float parts_randf(Parts *p) {
+    p->rng ^= p->rng << 13;
+    p->rng ^= p->rng >> 17;
+    p->rng ^= p->rng << 5;
+    return (p->rng >> 8) / (float)(1 << 24);
+}
+
+/* n bits flying out of pos, some of them pushed further along dir.
+ * once the pool is full, new ones are dropped */
+static void parts_burst(Parts *p, Vec2 pos, Vec2 dir, int n, float speed, float size, Color clr) {
+    if (!p) return;
+    if (!p->rng) p->rng = 1;
+    for (int i = 0; i < n && p->count < PART_MAX; i++) {
+        int j = p->count++;
+        Vec2 v = mul2f(rads2(parts_randf(p) * M_PI * 2.0f), speed * (0.3f + parts_randf(p)));
+        v = add2(v, mul2f(dir, speed * parts_randf(p)));
+        p->x[j] = pos.x, p->vx[j] = v.x;
+        p->y[j] = pos.y, p->vy[j] = v.y;
+        p->size[j] = size * (0.5f + parts_randf(p));
+        p->shrink[j] = p->size[j] / (20.0f + 20.0f * parts_randf(p));
+        p->color[j] = clr;
+    }
+}
+
+/* hits knock bits off of whatever was hit */
+static void parts_hit(World *w, Ent *hit) {
+    Vec2 at = add2(hit->pos, vec2(0.0f, (hit->looks == EntLooks_Pot) ? hit->radius : 0.5f));
+    if (hit->looks == EntLooks_Pot)
+        parts_burst(w->parts, at, vec2(0.0f, 0.0f), 10, 0.08f, 0.08f, Color_Brown),
+        parts_burst(w->parts, at, vec2(0.0f, 0.0f),  6, 0.06f, 0.10f, Color_DarkBrown);
+    else
+        parts_burst(w->parts, at, vec2(0.0f, 0.0f), 12, 0.07f, 0.06f, Color_Red);
+}
+
+static void parts_update(Parts *p) {
+    /* rounded up to whole vectors so -O2 vectorizes it without a tail;
+     * the slots past count are junk nobody reads */
+    int nvec = (p->count + 7) & ~7;
+    for (int i = 0; i < nvec; i++) {
+        p->x[i] += p->vx[i], p->vx[i] *= PART_DRAG;
+        p->y[i] += p->vy[i], p->vy[i] *= PART_DRAG;
+        p->size[i] -= p->shrink[i];
+    }
+
+    /* the dead are swapped with the last of the living */
+    int n = p->count;
+    for (int i = 0; i < n;) {
+        if (p->size[i] > 0.0f) { i++; continue; }
+        n--;
+        p->x[i] = p->x[n], p->vx[i] = p->vx[n];
+        p->y[i] = p->y[n], p->vy[i] = p->vy[n];
+        p->size[i] = p->size[n], p->shrink[i] = p->shrink[n];
+        p->color[i] = p->color[n];
+    }
+    p->count = n;
 }
 
 typedef struct {
     Geo *geo;
     uint16_t *idx;
     Vert *vert;
+    float scale; /* pixels per unit of the space being written, for tessellating */
 } GeoWtr;
 static GeoWtr geo_wtr(Geo *geo) {
-    return (GeoWtr) { .geo = geo, .vert = geo->verts, .idx = geo->idxs };
+    return (GeoWtr) { .geo = geo, .vert = geo->verts, .idx = geo->idxs, .scale = 1.0f };
 }
 
-static void geo_wtr_flush(GeoWtr *wtr) {
+static void geo_wtr_check(GeoWtr *wtr) {
     size_t v_used = wtr->vert - wtr->geo->verts;
     uint32_t max_v = wtr->geo->nvert;
     if (v_used > max_v) printf("%ld/%u verts used!\n", v_used, max_v), exit(1);
@@ -529,7 +2348,12 @@ static void geo_wtr_flush(GeoWtr *wtr) {
     size_t i_used = wtr->idx - wtr->geo->idxs;
     uint32_t max_i = wtr->geo->nidx;
     if (i_used > max_i) printf("%ld/%u idxs used!\n", i_used, max_i), exit(1);
-
+}
+static void geo_wtr_flush(GeoWtr *wtr) {
+    TRACE_BEGIN("geo_wtr_flush");
+    geo_wtr_check(wtr);
+    TRACE_COUNTER(wtr->geo->lvert, "used", wtr->vert - wtr->geo->verts, "cap", wtr->geo->nvert);
+    TRACE_COUNTER(wtr->geo->lidx,  "used", wtr->idx  - wtr->geo->idxs,  "cap", wtr->geo->nidx);
 
     sg_update_buffer(wtr->geo->bind.vertex_buffers[0], &(sg_range) {
         .ptr = wtr->geo->verts,
@@ -540,31 +2364,57 @@ static void geo_wtr_flush(GeoWtr *wtr) {
         .ptr = wtr->geo->idxs,
         .size = (wtr->idx - wtr->geo->idxs) * sizeof(uint16_t),
     });
+    TRACE_END("geo_wtr_flush");
 }
 
-static void write_circ(GeoWtr *wtr, float x, float y, float r, Color clr, float z) {
+/* circles get as many sides as keep their edges within CIRC_TOLERANCE_PX
+ * of round, up to the 9 they've always had */
+#define CIRC_MIN_SIDES (5)
+#define CIRC_MAX_SIDES (9)
+#define CIRC_TOLERANCE_PX (1.0f)
+static Vec2 circ_units[CIRC_MAX_SIDES + 1][CIRC_MAX_SIDES] = {
+    [5] = {
+        {{  0.0000f,  1.0000f }}, {{ -0.9511f,  0.3090f }}, {{ -0.5878f, -0.8090f }},
+        {{  0.5878f, -0.8090f }}, {{  0.9511f,  0.3090f }},
+    },
+    [6] = {
+        {{  0.0000f,  1.0000f }}, {{ -0.8660f,  0.5000f }}, {{ -0.8660f, -0.5000f }},
+        {{  0.0000f, -1.0000f }}, {{  0.8660f, -0.5000f }}, {{  0.8660f,  0.5000f }},
+    },
+    [7] = {
+        {{  0.0000f,  1.0000f }}, {{ -0.7818f,  0.6235f }}, {{ -0.9749f, -0.2225f }},
+        {{ -0.4339f, -0.9010f }}, {{  0.4339f, -0.9010f }}, {{  0.9749f, -0.2225f }},
+        {{  0.7818f,  0.6235f }},
+    },
+    [8] = {
+        {{  0.0000f,  1.0000f }}, {{ -0.7071f,  0.7071f }}, {{ -1.0000f,  0.0000f }},
+        {{ -0.7071f, -0.7071f }}, {{  0.0000f, -1.0000f }}, {{  0.7071f, -0.7071f }},
+        {{  1.0000f,  0.0000f }}, {{  0.7071f,  0.7071f }},
+    },
+    [9] = {
+        {{  0.0000f,  1.0000f }}, {{ -0.6428f,  0.7660f }}, {{ -0.9848f,  0.1736f }},
+        {{ -0.8660f, -0.5000f }}, {{ -0.3420f, -0.9397f }}, {{  0.3420f, -0.9397f }},
+        {{  0.8660f, -0.5000f }}, {{  0.9848f,  0.1736f }}, {{  0.6428f,  0.7660f }},
+    },
+};
+static int circ_sides(float r_px) {
+    if (r_px <= CIRC_TOLERANCE_PX) return CIRC_MIN_SIDES;
+    float n = ceilf(M_PI / acosf(1.0f - CIRC_TOLERANCE_PX / r_px));
+    return (int)fminf(fmaxf(n, CIRC_MIN_SIDES), CIRC_MAX_SIDES);
+}
+
+static void write_circ_n(GeoWtr *wtr, float x, float y, float r, Color clr, float z, int sides) {
     size_t start = wtr->vert - wtr->geo->verts;
-    uint16_t circ_indices[] = {
-        2 + start, 6 + start, 8 + start,
-        0 + start, 1 + start, 8 + start,
-        1 + start, 2 + start, 8 + start,
-        2 + start, 3 + start, 4 + start,
-        4 + start, 5 + start, 2 + start,
-        5 + start, 6 + start, 2 + start,
-        6 + start, 7 + start, 8 + start
-    };
-    memcpy(wtr->idx, circ_indices, sizeof(circ_indices));
-    wtr->idx += sizeof(circ_indices) / sizeof(uint16_t);
+    for (int i = 1; i < sides - 1; i++)
+        *(wtr->idx)++ = start,
+        *(wtr->idx)++ = start + i,
+        *(wtr->idx)++ = start + i + 1;
 
-    *(wtr->vert)++ = (Vert) { x + r *  0.0000f, y + r *  1.0000f, z, clr };
-    *(wtr->vert)++ = (Vert) { x + r * -0.6428f, y + r *  0.7660f, z, clr };
-    *(wtr->vert)++ = (Vert) { x + r * -0.9848f, y + r *  0.1736f, z, clr };
-    *(wtr->vert)++ = (Vert) { x + r * -0.8660f, y + r * -0.5000f, z, clr };
-    *(wtr->vert)++ = (Vert) { x + r * -0.3420f, y + r * -0.9397f, z, clr };
-    *(wtr->vert)++ = (Vert) { x + r *  0.3420f, y + r * -0.9397f, z, clr };
-    *(wtr->vert)++ = (Vert) { x + r *  0.8660f, y + r * -0.5000f, z, clr };
-    *(wtr->vert)++ = (Vert) { x + r *  0.9848f, y + r *  0.1736f, z, clr };
-    *(wtr->vert)++ = (Vert) { x + r *  0.6428f, y + r *  0.7660f, z, clr };
+    for (Vec2 *u = circ_units[sides]; (u - circ_units[sides]) < sides; u++)
+        *(wtr->vert)++ = (Vert) { x + r * u->x, y + r * u->y, z, clr };
+}
+static void write_circ(GeoWtr *wtr, float x, float y, float r, Color clr, float z) {
+    write_circ_n(wtr, x, y, r, clr, z, circ_sides(r * wtr->scale));
 }
 
 static void write_tri(GeoWtr *wtr, Vert v0, Vert v1, Vert v2) {
@@ -626,41 +2476,37 @@ static void write_line(
     *(wtr->idx)++ = vert0 + 3;
 }
 
-static void write_sight(GeoWtr *wtr, float x, float y, float r, Color clr, float z) {
+/* meshes modelled in blender, exported into meshes.json by blender_export_mesh.py
+ * and compiled into build/meshes.bytes by mesh2flat.py, which welds them and
+ * orders them for the vertex cache. load_meshes() reads them in at startup */
+#define MESH_PATH "build/meshes.bytes"
+#define MESH_VERSION (1)
+#define MESH_NAME_LEN (16)
+#define MESH_VERT_MAX (1 << 10)
+#define MESH_IDX_MAX (1 << 12)
+typedef enum { MeshKind_Bow, MeshKind_Sight, MeshKind_COUNT } MeshKind;
+static const char *mesh_names[MeshKind_COUNT] = {
+    [MeshKind_Bow]   = "bow",
+    [MeshKind_Sight] = "sight",
+};
+typedef struct { Vec2 *verts; uint16_t *idxs; int nvert, nidx; } Mesh;
+static struct {
+    Mesh meshes[MeshKind_COUNT];
+    Vec2 verts[MESH_VERT_MAX];
+    uint16_t idxs[MESH_IDX_MAX];
+} mesh_lib;
+
+static void write_mesh(GeoWtr *wtr, MeshKind kind, float x, float y, float scale, Color clr, float z) {
+    Mesh *m = mesh_lib.meshes + kind;
     size_t start = wtr->vert - wtr->geo->verts;
-    uint16_t circ_indices[] = {
-        5 + start, 13 + start,  6 + start,
-        3 + start, 11 + start,  4 + start,
-        1 + start,  9 + start,  2 + start,
-        6 + start,  7 + start,  0 + start,
-        4 + start, 12 + start,  5 + start,
-        3 + start,  9 + start, 10 + start,
-        0 + start,  8 + start,  1 + start,
-        5 + start, 12 + start, 13 + start,
-        3 + start, 10 + start, 11 + start,
-        1 + start,  8 + start,  9 + start,
-        6 + start, 13 + start,  7 + start,
-        4 + start, 11 + start, 12 + start,
-        3 + start,  2 + start,  9 + start,
-        0 + start,  7 + start,  8 + start
-    };
-    memcpy(wtr->idx, circ_indices, sizeof(circ_indices));
-    wtr->idx += sizeof(circ_indices) / sizeof(uint16_t);
-
-    *(wtr->vert)++ = (Vert) { x + r *  0.3405f, y + r *  0.9402f, z, clr };
-    *(wtr->vert)++ = (Vert) { x + r * -0.5228f, y + r *  0.8524f, z, clr };
-    *(wtr->vert)++ = (Vert) { x + r * -0.9924f, y + r *  0.1227f, z, clr };
-    *(wtr->vert)++ = (Vert) { x + r * -0.7147f, y + r * -0.6994f, z, clr };
-    *(wtr->vert)++ = (Vert) { x + r *  0.1012f, y + r * -0.9949f, z, clr };
-    *(wtr->vert)++ = (Vert) { x + r *  0.8409f, y + r * -0.5412f, z, clr };
-    *(wtr->vert)++ = (Vert) { x + r *  0.9474f, y + r *  0.3200f, z, clr };
-    *(wtr->vert)++ = (Vert) { x + r *  0.2554f, y + r *  0.7053f, z, clr };
-    *(wtr->vert)++ = (Vert) { x + r * -0.3922f, y + r *  0.6395f, z, clr };
-    *(wtr->vert)++ = (Vert) { x + r * -0.7445f, y + r *  0.0921f, z, clr };
-    *(wtr->vert)++ = (Vert) { x + r * -0.5362f, y + r * -0.5246f, z, clr };
-    *(wtr->vert)++ = (Vert) { x + r *  0.0759f, y + r * -0.7463f, z, clr };
-    *(wtr->vert)++ = (Vert) { x + r *  0.6308f, y + r * -0.4060f, z, clr };
-    *(wtr->vert)++ = (Vert) { x + r *  0.7107f, y + r *  0.2401f, z, clr };
+    for (uint16_t *i = m->idxs; (i - m->idxs) < m->nidx; i++)
+        *(wtr->idx)++ = start + *i;
+    for (Vec2 *v = m->verts; (v - m->verts) < m->nvert; v++)
+        *(wtr->vert)++ = (Vert) { x + scale * v->x, y + scale * v->y, z, clr };
+}
+
+static void write_sight(GeoWtr *wtr, float x, float y, float r, Color clr, float z) {
+    write_mesh(wtr, MeshKind_Sight, x, y, r, clr, z);
 
     write_rect(wtr, x + r - 0.2f*r, y - 0.125f*r, 1.0f*r, 0.25f*r, clr, z);
     write_rect(wtr, x - r + 0.2f*r, y - 0.125f*r, 1.0f*r, 0.25f*r, clr, z);
@@ -677,9 +2523,10 @@ static void _write_pot_inr(GeoWtr *wtr, float x, float y, float size, float scal
 #undef POT_RATIO
 }
 
+/* the fill is nearer than the rim around it, so it goes first */
 static void write_pot(GeoWtr *wtr, float x, float y, float size) {
-    _write_pot_inr(wtr, x, y, size, size, Color_DarkBrown, y);
     _write_pot_inr(wtr, x, y, size, size - 0.15f, Color_Brown, y - 0.01f);
+    _write_pot_inr(wtr, x, y, size, size, Color_DarkBrown, y);
 }
 
 #define GOLDEN_RATIO (1.618034f)
@@ -716,6 +2563,8 @@ static void write_sword(GeoWtr *wtr, float rads, float x, float y, float z) {
     }
 }
 
+/* the head's point, the furthest an arrow draws from where it's at */
+#define ARROW_TIP (1.34f)
 static void _write_arrow_inr(GeoWtr *wtr, float x, float z) {
     for (float f = 1.0f; f >= -1.0f; f -= 2.0f) {
         write_tri(wtr,
@@ -732,7 +2581,7 @@ static void _write_arrow_inr(GeoWtr *wtr, float x, float z) {
 
     write_line(wtr, 1.05f + x, 0.0f, 0.05f + x, 0.0f, 0.08f, Color_DarkBrown, z);
     write_tri(wtr,
-        (Vert) { 1.34f + x,  0.000f, z, Color_Grey },
+        (Vert) { ARROW_TIP + x,  0.000f, z, Color_Grey },
         (Vert) { 1.10f + x, -0.105f, z, Color_Grey },
         (Vert) { 1.10f + x,  0.105f, z, Color_Grey }
     );
@@ -755,79 +2604,18 @@ static void write_arrow(GeoWtr *wtr, float rads, float x, float y, float z) {
     }
 }
 
-static void write_bow(GeoWtr *wtr, float rads, float x, float y, float z, Ent *e) {
+static void write_bow(GeoWtr *wtr, World *w, float rads, float x, float y, float z, Ent *e) {
     Vert *vert0 = wtr->vert;
 
-    float r = 1.0f - (e->swing.end - state.tick) / ((float) item_attack_duration[e->item]);
+    float r = 1.0f - (e->swing.end - w->tick) / ((float) item_attack_duration[e->item]);
     if (r < 0.0f || r > 1.0f || e->swing.shot) r = 0.0f;
     write_line(wtr, -0.1f, -1.0f, -0.1f - r * 0.6f, 0.0f, 0.035f, Color_LightGrey, z);
     write_line(wtr, -0.1f,  1.0f, -0.1f - r * 0.6f, 0.0f, 0.035f, Color_LightGrey, z);
 
     if (r > 0.0f) _write_arrow_inr(wtr, -r, z);
 
-    /* generated by running gen_bow.py in Blender,
-     * then doing touchups manually to get bow.blend,
-     * then blender_log_mesh_data.py and formatting like so: */
-    size_t idx0 = wtr->vert - wtr->geo->verts;
-    uint16_t bow_indices[] = {
-         0 + idx0,  1 + idx0,  2 + idx0,
-         2 + idx0,  1 + idx0,  3 + idx0,
-         4 + idx0,  5 + idx0,  6 + idx0,
-         6 + idx0,  5 + idx0,  7 + idx0,
-         8 + idx0,  9 + idx0,  7 + idx0,
-         7 + idx0,  9 + idx0, 10 + idx0,
-        15 + idx0, 16 + idx0, 13 + idx0,
-        14 + idx0, 29 + idx0, 13 + idx0,
-        18 + idx0, 19 + idx0, 20 + idx0,
-        20 + idx0, 19 + idx0, 21 + idx0,
-        22 + idx0, 23 + idx0, 21 + idx0,
-        21 + idx0, 23 + idx0, 24 + idx0,
-        25 + idx0, 26 + idx0, 27 + idx0,
-        27 + idx0, 26 + idx0, 28 + idx0,
-         5 + idx0,  1 + idx0,  0 + idx0,
-         7 + idx0, 10 + idx0,  6 + idx0,
-        21 + idx0, 24 + idx0, 20 + idx0,
-        25 + idx0, 22 + idx0, 26 + idx0,
-        12 + idx0, 11 + idx0,  9 + idx0,
-        16 + idx0, 19 + idx0, 18 + idx0,
-        29 + idx0, 17 + idx0, 13 + idx0,
-        17 + idx0, 15 + idx0, 13 + idx0,
-        11 + idx0, 12 + idx0, 13 + idx0,
-        12 + idx0, 14 + idx0, 13 + idx0
-    };
-    memcpy(wtr->idx, bow_indices, sizeof(bow_indices));
-    wtr->idx += sizeof(bow_indices) / sizeof(uint16_t);
-
-    *(wtr->vert)++ = (Vert) {-0.1137f, -1.0178f, z, Color_Brown };
-    *(wtr->vert)++ = (Vert) {-0.0863f, -0.9822f, z, Color_Brown };
-    *(wtr->vert)++ = (Vert) { 0.0163f, -1.1178f, z, Color_Brown };
-    *(wtr->vert)++ = (Vert) { 0.0437f, -1.0822f, z, Color_Brown };
-    *(wtr->vert)++ = (Vert) {-0.0530f, -1.0235f, z, Color_Brown };
-    *(wtr->vert)++ = (Vert) {-0.1065f, -0.9765f, z, Color_Brown };
-    *(wtr->vert)++ = (Vert) { 0.2470f, -0.4235f, z, Color_Brown };
-    *(wtr->vert)++ = (Vert) { 0.1531f, -0.3844f, z, Color_Brown };
-    *(wtr->vert)++ = (Vert) { 0.2031f, -0.0922f, z, Color_Brown };
-    *(wtr->vert)++ = (Vert) { 0.2969f, -0.1078f, z, Color_Brown };
-    *(wtr->vert)++ = (Vert) { 0.2469f, -0.4078f, z, Color_Brown };
-    *(wtr->vert)++ = (Vert) { 0.2708f, -0.0688f, z, Color_Brown };
-    *(wtr->vert)++ = (Vert) { 0.2292f, -0.1312f, z, Color_Brown };
-    *(wtr->vert)++ = (Vert) { 0.1673f, -0.0000f, z, Color_Brown };
-    *(wtr->vert)++ = (Vert) { 0.0792f, -0.0312f, z, Color_Brown };
-    *(wtr->vert)++ = (Vert) { 0.2292f,  0.1312f, z, Color_Brown };
-    *(wtr->vert)++ = (Vert) { 0.2708f,  0.0688f, z, Color_Brown };
-    *(wtr->vert)++ = (Vert) { 0.0792f,  0.0312f, z, Color_Brown };
-    *(wtr->vert)++ = (Vert) { 0.2969f,  0.1078f, z, Color_Brown };
-    *(wtr->vert)++ = (Vert) { 0.2031f,  0.0922f, z, Color_Brown };
-    *(wtr->vert)++ = (Vert) { 0.2469f,  0.4078f, z, Color_Brown };
-    *(wtr->vert)++ = (Vert) { 0.1531f,  0.3844f, z, Color_Brown };
-    *(wtr->vert)++ = (Vert) {-0.1065f,  0.9765f, z, Color_Brown };
-    *(wtr->vert)++ = (Vert) {-0.0530f,  1.0235f, z, Color_Brown };
-    *(wtr->vert)++ = (Vert) { 0.2470f,  0.4235f, z, Color_Brown };
-    *(wtr->vert)++ = (Vert) {-0.0863f,  0.9822f, z, Color_Brown };
-    *(wtr->vert)++ = (Vert) {-0.1137f,  1.0178f, z, Color_Brown };
-    *(wtr->vert)++ = (Vert) { 0.0437f,  1.0822f, z, Color_Brown };
-    *(wtr->vert)++ = (Vert) { 0.0163f,  1.1178f, z, Color_Brown };
-    *(wtr->vert)++ = (Vert) { 0.1000f,  0.0000f, z, Color_Brown };
+    /* started as gen_bow.py run in blender, then touched up by hand in bow.blend */
+    write_mesh(wtr, MeshKind_Bow, 0.0f, 0.0f, 1.0f, Color_Brown, z);
 
     Mat2 m = z_rot2x2(rads);
     for (Vert *i = vert0; i < wtr->vert; i++) {
@@ -837,19 +2625,45 @@ static void write_bow(GeoWtr *wtr, float rads, float x, float y, float z, Ent *e
     }
 }
 
-static void write_text(GeoWtr *wtr, float x, float y, char *buf, Color clr) {
-    for (char *text = buf; *text; text++) {
-        stbtt_aligned_quad q;
-        stbtt_GetBakedQuad(cdata, 512,512, *text-32, &x,&y,&q,1);//1=opengl & d3d10+,0=d3d9
+/* how far a glyph that's left blank still moves the pen */
+static float glyph_advance(uint32_t codepoint, int px) {
+    if (!glyphs.img.id) return 0.0f;
+    int advance, lsb;
+    stbtt_GetGlyphHMetrics(&glyphs.info, stbtt_FindGlyphIndex(&glyphs.info, codepoint), &advance, &lsb);
+    return stbtt_ScaleForPixelHeight(&glyphs.info, px) * advance;
+}
+
+/* buf is utf-8, and px the height of a line */
+static void write_text_px(GeoWtr *wtr, float x, float y, int px, char *buf, Color clr) {
+    const float texel = 1.0f / GLYPH_ATLAS;
+    for (char *text = buf; *text;) {
+        uint32_t codepoint = utf8_next(&text);
+        Glyph *g = glyph_get(codepoint, px);
+        if (!g) {
+            x += glyph_advance(codepoint, px);
+            continue;
+        }
+
+        /* snapped to the pixel grid, as stbtt_GetBakedQuad() does */
+        float x0 = floorf(x + g->xoff + 0.5f), y0 = floorf(y + g->yoff + 0.5f),
+              x1 = x0 + g->x1 - g->x0,        y1 = y0 + g->y1 - g->y0;
+        float s0 = g->x0 * texel, t0 = g->y0 * texel,
+              s1 = g->x1 * texel, t1 = g->y1 * texel;
+        x += g->xadvance;
+        if (x0 == x1 || y0 == y1) continue;
+
         write_quad(
             wtr,
-            (Vert) { q.x0, q.y0, 0.0f, clr, q.s0, q.t1 },
-            (Vert) { q.x1, q.y0, 0.0f, clr, q.s1, q.t1 },
-            (Vert) { q.x1, q.y1, 0.0f, clr, q.s1, q.t0 },
-            (Vert) { q.x0, q.y1, 0.0f, clr, q.s0, q.t0 }
+            (Vert) { x0, y0, 0.0f, clr, s0, t1 },
+            (Vert) { x1, y0, 0.0f, clr, s1, t1 },
+            (Vert) { x1, y1, 0.0f, clr, s1, t0 },
+            (Vert) { x0, y1, 0.0f, clr, s0, t0 }
         );
     }
 }
+static void write_text(GeoWtr *wtr, float x, float y, char *buf, Color clr) {
+    write_text_px(wtr, x, y, TEXT_PX, buf, clr);
+}
 
 static void write_corner(GeoWtr *wtr, float x, float y, float mx, float my, Color clr, float z) {
     write_line(wtr, x-16.0f*mx, y-48.0f*my, x-16.0f*mx, y-11.2f*my, 16.0f, clr, z);
@@ -857,10 +2671,10 @@ static void write_corner(GeoWtr *wtr, float x, float y, float mx, float my, Colo
     write_line(wtr, x+11.2f*mx, y+16.0f*my, x+52.0f*mx, y+16.0f*my, 16.0f, clr, z);
 }
 
-static void write_item(GeoWtr *wtr, float rot, Vec2 pos, Ent *ent, float z) {
+static void write_item(GeoWtr *wtr, World *w, float rot, Vec2 pos, Ent *ent, float z) {
     switch (ent->item) {
-    case EntItem_Sword: write_sword(wtr, rot, pos.x, pos.y, z);      break;
-    case EntItem_Bow:   write_bow  (wtr, rot, pos.x, pos.y, z, ent); break;
+    case EntItem_Sword: write_sword(wtr,    rot, pos.x, pos.y, z);      break;
+    case EntItem_Bow:   write_bow  (wtr, w, rot, pos.x, pos.y, z, ent); break;
     case EntItem_None:
     case EntItem_COUNT:
         break;
@@ -875,66 +2689,394 @@ static void write_frame(GeoWtr *wtr, float x, float y, float w, float h) {
     w -= 64.0f;
     h -= 64.0f;
 
-    float z = 0.0f;
-    float w2 = w / 2.0f;
-    float h2 = h / 2.0f;
-    x += w2, y += h2;
+    float z = 0.0f;
+    float w2 = w / 2.0f;
+    float h2 = h / 2.0f;
+    x += w2, y += h2;
+
+    write_rect(wtr, x, y - 8.0f - h2, w + 16.0f, h + 16.0f, Color_DarkBrown, z);
+
+    for (float u = 1.0f; u >= -1.0f; u -= 2.0f) {
+        for (float v = 1.0f; v >= -1.0f; v -= 2.0f) {
+            write_corner(wtr, u*(-w2+PULL+GAP)+x, v*(h2-PULL-GAP)+y, u, v, Color_DarkGrey, z);
+        }
+    }
+
+    // for not jank ui: s/- 4.0f/+10.4/g
+    // don't forget the /g, that's how we got the jank in the first place
+    write_line(wtr, -w2+x,  h2+y,        w2+x,  16.0f+h2+y, 16.0f, Color_Brown, z);
+    write_line(wtr, -w2+x, -h2+y,        w2+x, -16.0f-h2+y, 16.0f, Color_Brown, z);
+    write_line(wtr, -w2+x,  h2+y, -16.0f-w2+x,       -h2+y, 16.0f, Color_Brown, z);
+    write_line(wtr,  w2+x,  h2+y,  16.0f+w2+x,       -h2+y, 16.0f, Color_Brown, z);
+    
+    for (float u = 1.0f; u >= -1.0f; u -= 2.0f) {
+        for (float v = 1.0f; v >= -1.0f; v -= 2.0f) {
+            write_corner(wtr, u*(-w2+PULL-GAP)+x, v*(h2-PULL+GAP)+y, u, v, Color_LightishGrey, z);
+            write_corner(wtr, u*(-w2+PULL    )+x, v*(h2-PULL    )+y, u, v, Color_Grey, z);
+        }
+    }
+#undef GAP
+#undef PULL
+}
+
+#define map (state.level.map)
+/* nearest first: the leaves, then the trunk, then what's behind it. the trunk
+ * still comes before the border that shares its z and covers its top */
+static void write_tree(GeoWtr *wtr, MapData_Tree *t, MapLod lod) {
+    float w = 0.8f, h = GOLDEN_RATIO, r = 0.4f, sr = 0.92f;
+    switch (lod) {
+    case MapLod_Full: {
+        write_circ(wtr, t->x + 0.80f, t->y + 2.2f, 0.8f, Color_TreeGreen,  t->y - 1.1f);
+        write_circ(wtr, t->x + 0.16f, t->y + 3.0f, 1.0f, Color_TreeGreen1, t->y - 1.1f);
+        write_circ(wtr, t->x - 0.80f, t->y + 2.5f, 0.9f, Color_TreeGreen2, t->y - 1.1f);
+        write_circ(wtr, t->x - 0.16f, t->y + 2.0f, 0.8f, Color_TreeGreen3, t->y - 1.1f);
+
+        write_circ(wtr, t->x, t->y + r, r, Color_Brown, t->y);
+        write_rect(wtr, t->x, t->y + r, w, h, Color_Brown, t->y);
+
+        write_circ(wtr, t->x + 0.80f, t->y + 2.2f, 0.8f+0.1f, Color_TreeBorder, t->y);
+        write_circ(wtr, t->x + 0.16f, t->y + 3.0f, 1.0f+0.1f, Color_TreeBorder, t->y);
+        write_circ(wtr, t->x - 0.80f, t->y + 2.5f, 0.9f+0.1f, Color_TreeBorder, t->y);
+        write_circ(wtr, t->x - 0.16f, t->y + 2.0f, 0.8f+0.1f, Color_TreeBorder, t->y);
+
+        write_circ(wtr, t->x, t->y + r, sr, Color_ForestShadow, t->y + sr);
+    } break;
+    /* the four leafy circles become one that covers them */
+    case MapLod_Simple: {
+        write_circ(wtr, t->x, t->y + 2.6f, 1.45f, Color_TreeGreen1, t->y - 1.1f);
+        write_rect(wtr, t->x, t->y + r, w, h, Color_Brown, t->y);
+        write_circ(wtr, t->x, t->y + 2.6f, 1.55f, Color_TreeBorder, t->y);
+        write_circ(wtr, t->x, t->y + r, sr, Color_ForestShadow, t->y + sr);
+    } break;
+    case MapLod_Blob: {
+        write_circ(wtr, t->x, t->y + 2.4f, 1.6f, Color_TreeGreen2, t->y - 1.1f);
+    } break;
+    case MapLod_COUNT: break;
+    }
+}
+
+static int map_tree_chunk_x(const MapData_Tree *t) { return (int)floorf(t->x / MAP_CHUNK_SIZE); }
+static int map_tree_chunk_y(const MapData_Tree *t) { return (int)floorf(t->y / MAP_CHUNK_SIZE); }
+
+static uint32_t map_chunk_bucket(int x, int y) {
+    return ((uint32_t)x * 73856093u ^ (uint32_t)y * 19349663u) & (MAP_CHUNK_BUCKETS - 1);
+}
+static MapChunk *map_chunk_at(int x, int y) {
+    uint32_t b = map_chunk_bucket(x, y);
+    for (; state.chunk_lookup[b]; b = (b + 1) & (MAP_CHUNK_BUCKETS - 1)) {
+        MapChunk *c = state.chunks + state.chunk_lookup[b] - 1;
+        if (c->x == x && c->y == y) return c;
+    }
+
+    if (state.nchunk == MAP_CHUNK_MAX) printf("more than %d map chunks!\n", MAP_CHUNK_MAX), exit(1);
+    MapChunk *c = state.chunks + state.nchunk++;
+    *c = (MapChunk) { .x = x, .y = y };
+    state.chunk_lookup[b] = state.nchunk;
+    return c;
+}
+/* after chunks have been moved around in state.chunks */
+static void map_chunk_lookup_rebuild(void) {
+    memset(state.chunk_lookup, 0, sizeof(state.chunk_lookup));
+    for (MapChunk *c = state.chunks; (c - state.chunks) < state.nchunk; c++) {
+        uint32_t b = map_chunk_bucket(c->x, c->y);
+        while (state.chunk_lookup[b]) b = (b + 1) & (MAP_CHUNK_BUCKETS - 1);
+        state.chunk_lookup[b] = c - state.chunks + 1;
+    }
+}
+
+/* map_sort() puts each chunk's trees in one run, which this finds */
+static MapData_Tree *map_chunk_trees(MapChunk *c, MapData_Tree **end) {
+    int lo = 0, hi = map.ntrees;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2, my = map_tree_chunk_y(map.trees + mid), mx = map_tree_chunk_x(map.trees + mid);
+        if (my < c->y || (my == c->y && mx < c->x)) lo = mid + 1;
+        else                                        hi = mid;
+    }
+    MapData_Tree *t = map.trees + lo;
+    for (*end = t; (*end - map.trees) < map.ntrees; ++*end)
+        if (map_tree_chunk_x(*end) != c->x || map_tree_chunk_y(*end) != c->y) break;
+    return t;
+}
+static MapChunk *map_chunk_of(MapData_Tree *t) {
+    return map_chunk_at(map_tree_chunk_x(t), map_tree_chunk_y(t));
+}
+
+/* each level is tessellated for the most pixels per unit it's drawn at */
+static void map_chunk_write(GeoWtr *wtr, MapChunk *c) {
+    uint16_t *start = wtr->idx;
+    MapData_Tree *end, *first = map_chunk_trees(c, &end);
+    for (MapLod lod = 0; lod < MapLod_COUNT; lod++) {
+        wtr->scale = lod ? map_lod_min_scale[lod - 1] : POS_INF_F;
+        c->lod_first[lod] = wtr->idx - start;
+        for (MapData_Tree *t = first; t < end; t++)
+            write_tree(wtr, t, lod);
+        c->lod_nidx[lod] = (wtr->idx - start) - c->lod_first[lod];
+    }
+    geo_wtr_check(wtr);
+}
+
+/* replaces the chunk's buffers with new ones holding these */
+static void map_chunk_upload(MapChunk *c, Vert *verts, int nvert, uint16_t *idxs, int nidx) {
+    if (c->nidx) sg_destroy_buffer(c->vbuf), sg_destroy_buffer(c->ibuf);
+    c->dirty = 0;
+    c->nidx = nidx;
+    c->front_z = geo_front_z(verts, verts + nvert);
+    if (!c->nidx) return;
+
+    size_t vsize = nvert * sizeof(Vert), isize = nidx * sizeof(uint16_t);
+    c->vbuf = sg_make_buffer(&(sg_buffer_desc) {
+        .size = vsize,
+        .data = (sg_range) { .ptr = verts, .size = vsize },
+        .usage = SG_USAGE_IMMUTABLE,
+        .label = "map_chunk_vert"
+    });
+    c->ibuf = sg_make_buffer(&(sg_buffer_desc) {
+        .size = isize,
+        .type = SG_BUFFERTYPE_INDEXBUFFER,
+        .data = (sg_range) { .ptr = idxs, .size = isize },
+        .usage = SG_USAGE_IMMUTABLE,
+        .label = "map_chunk_idx"
+    });
+}
+
+/* writes the chunk's trees into static_geo, then uploads them */
+static void map_chunk_build(MapChunk *c) {
+    Geo *geo = &state.static_geo;
+    GeoWtr wtr = geo_wtr(geo);
+    map_chunk_write(&wtr, c);
+    geo_find_z_range(geo->verts, wtr.vert);
+    map_chunk_upload(c, geo->verts, wtr.vert - geo->verts, geo->idxs, wtr.idx - geo->idxs);
+}
+
+static MapLod map_lod_pick(void) {
+    float scale = view_scale();
+    MapLod lod = MapLod_Full;
+    while (scale < map_lod_min_scale[lod]) lod++;
+    return lod;
+}
+
+static int map_chunk_visible(MapChunk *c) {
+    Vec2 center = vec2((c->x + 0.5f) * MAP_CHUNK_SIZE, (c->y + 0.5f) * MAP_CHUNK_SIZE);
+    return view_overlaps(view_half_size(), center, MAP_CHUNK_SIZE / 2.0f + MAP_CHUNK_OVERHANG);
+}
+
+/* rebuilds the dirty chunks, dropping any left without trees.
+ * returns how many were rebuilt */
+static int map_chunks_build(void) {
+    int built = 0, dropped = 0;
+    for (int i = 0; i < state.nchunk;) {
+        MapChunk *c = state.chunks + i;
+        if (c->dirty) map_chunk_build(c), built++;
+        if (c->nidx) i++;
+        else *c = state.chunks[--state.nchunk], dropped = 1;
+    }
+    if (dropped) map_chunk_lookup_rebuild();
+    return built;
+}
+
+static int map_chunks_rebuild_all(void) {
+    for (MapData_Tree *t = map.trees; (t - map.trees) < map.ntrees; t++)
+        map_chunk_of(t)->dirty = 1;
+    return map_chunks_build();
+}
 
-    write_rect(wtr, x, y - 8.0f - h2, w + 16.0f, h + 16.0f, Color_DarkBrown, z);
+/* by chunk, so each chunk's trees are one run, then by y, so it writes them
+ * nearest first */
+static int map_tree_cmp(const void *a, const void *b) {
+    const MapData_Tree *l = a, *r = b;
+    int lcy = map_tree_chunk_y(l), rcy = map_tree_chunk_y(r),
+        lcx = map_tree_chunk_x(l), rcx = map_tree_chunk_x(r);
+    if (lcy != rcy) return (lcy > rcy) - (lcy < rcy);
+    if (lcx != rcx) return (lcx > rcx) - (lcx < rcx);
+    if (l->y != r->y) return (l->y > r->y) - (l->y < r->y);
+    return (l->x > r->x) - (l->x < r->x);
+}
+static int map_circle_cmp(const void *a, const void *b) {
+    const MapData_Circle *l = a, *r = b;
+    if (l->x != r->x) return (l->x > r->x) - (l->x < r->x);
+    if (l->y != r->y) return (l->y > r->y) - (l->y < r->y);
+    return (l->radius > r->radius) - (l->radius < r->radius);
+}
+/* sorted, two versions of the map can be diffed in one pass */
+static void map_sort(MapData *md) {
+    qsort(md->trees, md->ntrees, sizeof(MapData_Tree), map_tree_cmp);
+    qsort(md->circles, md->ncircles, sizeof(MapData_Circle), map_circle_cmp);
+}
+/* of the sorted trees, which are all the chunks are built from */
+static uint32_t map_trees_hash(MapData *md) {
+    return fnv1a(md->trees, sizeof(MapData_Tree) * md->ntrees);
+}
 
-    for (float u = 1.0f; u >= -1.0f; u -= 2.0f) {
-        for (float v = 1.0f; v >= -1.0f; v -= 2.0f) {
-            write_corner(wtr, u*(-w2+PULL+GAP)+x, v*(h2-PULL-GAP)+y, u, v, Color_DarkGrey, z);
-        }
+static MapData map_copy(MapData md, Arena *a) {
+    MapData copy = md;
+    copy.trees = ARENA_ARRAY(a, MapData_Tree, md.ntrees);
+    copy.circles = ARENA_ARRAY(a, MapData_Circle, md.ncircles);
+    memcpy(copy.trees, md.trees, sizeof(MapData_Tree) * md.ntrees);
+    memcpy(copy.circles, md.circles, sizeof(MapData_Circle) * md.ncircles);
+    return copy;
+}
+
+/* swaps a copy of md in for the current map. the new Level is built in Mem_MapNext,
+ * which then trades places with Mem_Map. only the chunks holding added or removed
+ * trees are rebuilt, and the terrain sdf is patched rather than rebaked where it
+ * can be. returns how many chunks were rebuilt */
+static int map_reload(MapData md, const char *sdf_path) {
+    Arena *next = mem + Mem_MapNext;
+    md = map_copy(md, next);
+    map_sort(&md);
+
+    for (uint32_t o = 0, n = 0; o < map.ntrees || n < md.ntrees;) {
+        int cmp = (o == map.ntrees) ?  1 :
+                  (n == md.ntrees)  ? -1 : map_tree_cmp(map.trees + o, md.trees + n);
+        if (cmp == 0) { o++, n++; continue; }
+        map_chunk_of((cmp < 0) ? map.trees + o++ : md.trees + n++)->dirty = 1;
     }
 
-    // for not jank ui: s/- 4.0f/+10.4/g
-    // don't forget the /g, that's how we got the jank in the first place
-    write_line(wtr, -w2+x,  h2+y,        w2+x,  16.0f+h2+y, 16.0f, Color_Brown, z);
-    write_line(wtr, -w2+x, -h2+y,        w2+x, -16.0f-h2+y, 16.0f, Color_Brown, z);
-    write_line(wtr, -w2+x,  h2+y, -16.0f-w2+x,       -h2+y, 16.0f, Color_Brown, z);
-    write_line(wtr,  w2+x,  h2+y,  16.0f+w2+x,       -h2+y, 16.0f, Color_Brown, z);
-    
-    for (float u = 1.0f; u >= -1.0f; u -= 2.0f) {
-        for (float v = 1.0f; v >= -1.0f; v -= 2.0f) {
-            write_corner(wtr, u*(-w2+PULL-GAP)+x, v*(h2-PULL+GAP)+y, u, v, Color_LightishGrey, z);
-            write_corner(wtr, u*(-w2+PULL    )+x, v*(h2-PULL    )+y, u, v, Color_Grey, z);
-        }
+    TerrainCirc *gone  = ARENA_ARRAY(mem + Mem_Frame, TerrainCirc, map.ncircles),
+                *added = ARENA_ARRAY(mem + Mem_Frame, TerrainCirc, md.ncircles);
+    int ngone = 0, nadded = 0;
+    for (uint32_t o = 0, n = 0; o < map.ncircles || n < md.ncircles;) {
+        int cmp = (o == map.ncircles) ?  1 :
+                  (n == md.ncircles)  ? -1 : map_circle_cmp(map.circles + o, md.circles + n);
+        if (cmp == 0) { o++, n++; continue; }
+        MapData_Circle *c = (cmp < 0) ? map.circles + o++ : md.circles + n++;
+        *((cmp < 0) ? gone + ngone++ : added + nadded++) =
+            (TerrainCirc) { .pos = vec2(c->x, c->y), .radius = c->radius };
     }
-#undef GAP
-#undef PULL
-}
 
-#define map (state.map)
-static size_t write_map(Geo *geo) {
-    GeoWtr wtr = geo_wtr(geo); 
+    map = md;
+
+    int built = map_chunks_build();
+    TerrainSdf old = state.level.terrain.sdf;
+    terrain_init(&state.level.terrain, &map, next);
+    terrain_sdf_patch(&state.level.terrain, old, gone, ngone, added, nadded, sdf_path, next);
+    arena_swap(mem + Mem_Map, next);
+    arena_reset(next);
 
-    for (MapData_Tree *t = map.trees; (t - map.trees) < map.ntrees; t++) {
-        float w = 0.8f, h = GOLDEN_RATIO, r = 0.4f;
-        write_circ(&wtr, t->x, t->y + r, r, Color_Brown, t->y);
-        write_rect(&wtr, t->x, t->y + r, w, h, Color_Brown, t->y);
+    /* the nav grid's bounds include the trees, so it's cheaper to redo than to diff.
+     * every World's flow fields see the new gen and restart */
+    nav_grid_init(&state.level.nav, &map);
 
-        write_circ(&wtr, t->x + 0.80f, t->y + 2.2f, 0.8f, Color_TreeGreen,  t->y - 1.1f);
-        write_circ(&wtr, t->x + 0.16f, t->y + 3.0f, 1.0f, Color_TreeGreen1, t->y - 1.1f);
-        write_circ(&wtr, t->x - 0.80f, t->y + 2.5f, 0.9f, Color_TreeGreen2, t->y - 1.1f);
-        write_circ(&wtr, t->x - 0.16f, t->y + 2.0f, 0.8f, Color_TreeGreen3, t->y - 1.1f);
+    return built;
+}
+
+/* polls map.bytes, reloading it once it has gone a poll without changing,
+ * so a file that's still being written is never parsed */
+static void map_watch(void) {
+    if (stm_ms(stm_since(state.map_watch.checked)) < MAP_WATCH_MS) return;
+    state.map_watch.checked = stm_now();
+
+    struct stat st;
+    if (stat(MAP_PATH, &st)) return;
+    int changed = st.st_mtime != state.map_watch.mtime || st.st_size != state.map_watch.size;
+    state.map_watch.mtime = st.st_mtime;
+    state.map_watch.size = st.st_size;
+    if (changed) { state.map_watch.pending = 1; return; }
+    if (!state.map_watch.pending) return;
+    state.map_watch.pending = 0;
+
+    FILE *f = fopen(MAP_PATH, "rb");
+    if (!f) return;
+    uint64_t start = stm_now();
+    MapData md = parse_map_data(f, mem + Mem_Frame);
+    fclose(f);
+    int built = map_reload(md, TERRAIN_SDF_PATH);
+    printf("reloaded %s: %d chunks rebuilt in %.2fms\n", MAP_PATH, built, stm_ms(stm_since(start)));
+}
+#undef map
+
+static void palette_bake(uint8_t palette[8*8*4]) {
+    uint8_t *plt_wtr = palette;
+#define X(name, r, g, b, a) \
+    *plt_wtr++ = (uint8_t)(r * 255.0); \
+    *plt_wtr++ = (uint8_t)(g * 255.0); \
+    *plt_wtr++ = (uint8_t)(b * 255.0); \
+    *plt_wtr++ = (uint8_t)(a * 255.0); 
+    PALETTE
+#undef X
+}
 
-        write_circ(&wtr, t->x + 0.80f, t->y + 2.2f, 0.8f+0.1f, Color_TreeBorder, t->y);
-        write_circ(&wtr, t->x + 0.16f, t->y + 3.0f, 1.0f+0.1f, Color_TreeBorder, t->y);
-        write_circ(&wtr, t->x - 0.80f, t->y + 2.5f, 0.9f+0.1f, Color_TreeBorder, t->y);
-        write_circ(&wtr, t->x - 0.16f, t->y + 2.0f, 0.8f+0.1f, Color_TreeBorder, t->y);
+/* the whole file, read-only; NULL if it can't be had */
+static uint8_t *file_map(const char *path, size_t *size) {
+#ifdef _MSC_VER
+    FILE *f = fopen(path, "rb");
+    if (!f) return NULL;
+    fseek(f, 0, SEEK_END);
+    *size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint8_t *data = malloc(*size);
+    if (fread(data, 1, *size, f) != *size) free(data), data = NULL;
+    fclose(f);
+    return data;
+#else
+    struct stat st;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+    void *data = fstat(fd, &st) ? MAP_FAILED : mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return NULL;
+    *size = st.st_size;
+    return data;
+#endif
+}
+static void file_unmap(uint8_t *data, size_t size) {
+#ifdef _MSC_VER
+    free(data);
+#else
+    munmap(data, size);
+#endif
+}
 
-        float sr = 0.92f;
-        write_circ(&wtr, t->x, t->y + r, sr, Color_ForestShadow, t->y + sr);
+/* checks every offset in the pack lands inside it before anything trusts them */
+static int asset_pack_valid(uint8_t *pack, size_t size) {
+    AssetPackHeader *head = (AssetPackHeader *)pack;
+    size_t table_end = sizeof(AssetPackHeader) + sizeof(AssetPackTex);
+    if (size < table_end ||
+        memcmp(head->magic, "APAK", 4) ||
+        head->version != ASSET_PACK_VERSION ||
+        head->size != size ||
+        head->nchunk > MAP_CHUNK_MAX)
+        return 0;
+
+    AssetPackChunk *chunks = (AssetPackChunk *)(pack + table_end);
+    table_end += sizeof(AssetPackChunk) * head->nchunk;
+    if (size < table_end) return 0;
+    for (AssetPackChunk *c = chunks; (c - chunks) < head->nchunk; c++) {
+        if (c->vert_offset % ASSET_PACK_ALIGN || c->idx_offset % ASSET_PACK_ALIGN ||
+            c->nvert > (1 << 16) ||
+            c->vert_offset < table_end || c->vert_offset + (size_t)c->nvert * sizeof(Vert) > size ||
+            c->idx_offset  < table_end || c->idx_offset  + (size_t)c->nidx * sizeof(uint16_t) > size)
+            return 0;
+        for (MapLod lod = 0; lod < MapLod_COUNT; lod++)
+            if ((size_t)c->lod_first[lod] + c->lod_nidx[lod] > c->nidx) return 0;
     }
+    return 1;
+}
 
-    geo_find_z_range(geo->verts, wtr.vert);
-    return wtr.idx - geo->idxs;
+/* uploads the pack's chunks straight from the mapping, if they're for this map */
+static int asset_pack_load_chunks(uint8_t *pack) {
+    AssetPackHeader *head = (AssetPackHeader *)pack;
+    if (head->map_hash != map_trees_hash(&state.level.map)) return 0;
+
+    AssetPackChunk *chunks = (AssetPackChunk *)(pack + sizeof(AssetPackHeader) + sizeof(AssetPackTex));
+    for (AssetPackChunk *c = chunks; (c - chunks) < head->nchunk; c++) {
+        MapChunk *mc = map_chunk_at(c->x, c->y);
+        for (MapLod lod = 0; lod < MapLod_COUNT; lod++)
+            mc->lod_first[lod] = c->lod_first[lod],
+            mc->lod_nidx[lod] = c->lod_nidx[lod];
+        map_chunk_upload(
+            mc,
+            (Vert *)(pack + c->vert_offset), c->nvert,
+            (uint16_t *)(pack + c->idx_offset), c->nidx
+        );
+    }
+    geo_min_z = fminf(geo_min_z, head->min_z);
+    geo_max_z = fmaxf(geo_max_z, head->max_z);
+    return 1;
 }
-#undef map
 
 static void ui_init(void) {
-    UiBox *inventory, *wtr = state.ui.boxes;
+    UiBox *inventory, *wtr = state.ui->boxes;
     *(inventory = wtr++) = (UiBox) {
         .looks = UiBoxLooks_Frame,
         .props = UiBoxProp_CanDrag,
@@ -959,7 +3101,7 @@ static void ui_init(void) {
     }
 
     *slot_pos_wtr++ = vec2(100.0f, 55.0f);
-    state.ui.player_weapon_slot = wtr + 6;
+    state.ui->player_weapon_slot = wtr + 6;
 
     for (Vec2 *p = slot_poses; p != slot_pos_wtr; p++) {
         UiBox *slot = wtr++;
@@ -985,18 +3127,231 @@ static void ui_init(void) {
         item->item = ((p - slot_poses) % 2) ? EntItem_Sword : EntItem_Bow;
     }
 
-    state.ui.root = state.ui.boxes;
+    state.ui->root = state.ui->boxes;
+}
+
+/* startup: the slow parts of loading that don't need each other run as tasks on
+ * a few loader threads while frame() draws a loading bar. anything touching the
+ * gpu is left to load_poll() on the main thread, once the tasks it needs are done */
+#define LOADER_THREADS 3
+typedef enum {
+    LoadTask_Map,     /* map.bytes, parsed and sorted */
+    LoadTask_Terrain, /* the map's terrain circles and sdf */
+    LoadTask_Nav,     /* the map's nav grid */
+    LoadTask_Pack,    /* assets.pack, mapped and checked */
+    LoadTask_Font,    /* the ttf mapped, for the atlas to rasterize from as it goes */
+    LoadTask_Meshes,  /* meshes.bytes, into mesh_lib */
+    LoadTask_COUNT,
+} LoadTask;
+#define LOAD_ALL ((1u << LoadTask_COUNT) - 1)
+
+/* what's landed on the main thread, as load_poll() gets to it */
+typedef enum {
+    LoadLanded_Font   = 1 << 0,
+    LoadLanded_Chunks = 1 << 1,
+    LoadLanded_All    = (1 << 2) - 1,
+} LoadLanded;
+
+static struct {
+    _Atomic uint32_t claimed, done; /* LoadTask bits */
+    int nthread; /* the main thread runs a task a frame itself if it got none */
+#ifndef _MSC_VER
+    pthread_t threads[LOADER_THREADS];
+#endif
+    uint8_t *pack; size_t pack_size;
+    LoadLanded landed;
+    uint64_t start, first_frame, interactive; /* sokol_time, since init() was called */
+} load;
+
+static void load_map(void) {
+    struct stat st;
+    FILE *map_file = fopen(MAP_PATH, "rb");
+    if (!map_file || fstat(fileno(map_file), &st)) perror("couldn't open map"), exit(1);
+    state.map_watch.mtime = st.st_mtime;
+    state.map_watch.size = st.st_size;
+    state.level.map = parse_map_data(map_file, mem + Mem_Map);
+    fclose(map_file);
+    map_sort(&state.level.map);
+}
+static void load_terrain(void) {
+    terrain_init(&state.level.terrain, &state.level.map, mem + Mem_Map);
+    terrain_sdf_init(&state.level.terrain, TERRAIN_SDF_PATH, mem + Mem_Map);
+}
+static void load_nav(void) {
+    nav_grid_init(&state.level.nav, &state.level.map);
+}
+static void load_pack(void) {
+    load.pack = file_map(ASSET_PACK_PATH, &load.pack_size);
+    if (load.pack && !asset_pack_valid(load.pack, load.pack_size)) {
+        fprintf(stderr, "%s is stale or corrupt, baking assets at startup\n", ASSET_PACK_PATH);
+        file_unmap(load.pack, load.pack_size);
+        load.pack = NULL;
+    }
+}
+/* nothing is rasterized until it's written, see glyph_get */
+static void load_font(void) {
+    glyphs.ttf = file_map(FONT_PATH, &glyphs.ttf_size);
+    if (!glyphs.ttf) perror("couldn't open " FONT_PATH), exit(1);
+    if (!stbtt_InitFont(&glyphs.info, glyphs.ttf, stbtt_GetFontOffsetForIndex(glyphs.ttf, 0)))
+        printf("%s isn't a font stb_truetype can read\n", FONT_PATH), exit(1);
+    glyphs.pixels = arena_push(mem + Mem_Font, GLYPH_ATLAS*GLYPH_ATLAS);
+    glyphs_clear();
+}
+
+/* as mesh2flat.py lays it out: a header, then each mesh's header, verts and
+ * idxs, padded to 4 bytes */
+static int mesh_lib_read(FILE *f) {
+    struct { char magic[4]; uint32_t version, count; } head;
+    if (fread(&head, sizeof(head), 1, f) < 1 ||
+        memcmp(head.magic, "MESH", 4) || head.version != MESH_VERSION)
+        return 0;
+
+    Vec2 *vert = mesh_lib.verts;
+    uint16_t *idx = mesh_lib.idxs;
+    for (uint32_t i = 0; i < head.count; i++) {
+        struct { char name[MESH_NAME_LEN]; uint32_t nvert, nidx; } mh;
+        if (fread(&mh, sizeof(mh), 1, f) < 1 ||
+            mh.nvert > MESH_VERT_MAX - (vert - mesh_lib.verts) ||
+            mh.nidx  > MESH_IDX_MAX  - (idx  - mesh_lib.idxs) ||
+            fread(vert, sizeof(Vec2), mh.nvert, f) < mh.nvert ||
+            fread(idx, sizeof(uint16_t), mh.nidx, f) < mh.nidx ||
+            fseek(f, (mh.nidx % 2) * sizeof(uint16_t), SEEK_CUR))
+            return 0;
+        for (uint16_t *j = idx; (j - idx) < mh.nidx; j++)
+            if (*j >= mh.nvert) return 0;
+
+        /* ones the game doesn't know about are read past */
+        mh.name[MESH_NAME_LEN - 1] = 0;
+        for (MeshKind k = 0; k < MeshKind_COUNT; k++)
+            if (!strcmp(mh.name, mesh_names[k]))
+                mesh_lib.meshes[k] = (Mesh) { vert, idx, mh.nvert, mh.nidx };
+        vert += mh.nvert, idx += mh.nidx;
+    }
+    return 1;
+}
+static void load_meshes(void) {
+    FILE *f = fopen(MESH_PATH, "rb");
+    if (!f) perror("couldn't open " MESH_PATH), exit(1);
+    if (!mesh_lib_read(f)) printf("%s is stale or corrupt, rerun mesh2flat.py\n", MESH_PATH), exit(1);
+    fclose(f);
+    for (MeshKind k = 0; k < MeshKind_COUNT; k++)
+        if (!mesh_lib.meshes[k].nidx) printf("no %s mesh in %s\n", mesh_names[k], MESH_PATH), exit(1);
+}
+
+static const struct { const char *name; void (*run)(void); uint32_t after; } load_tasks[LoadTask_COUNT] = {
+    [LoadTask_Map]     = { "load map",     load_map },
+    [LoadTask_Terrain] = { "load terrain", load_terrain, 1u << LoadTask_Map },
+    [LoadTask_Nav]     = { "load nav",     load_nav,     1u << LoadTask_Map },
+    [LoadTask_Pack]    = { "load pack",    load_pack },
+    [LoadTask_Font]    = { "load font",    load_font },
+    [LoadTask_Meshes]  = { "load meshes",  load_meshes },
+};
+
+/* a task whose dependencies are done and that nobody else has, or -1 */
+static int load_claim(void) {
+    uint32_t done = atomic_load(&load.done);
+    for (LoadTask t = 0; t < LoadTask_COUNT; t++) {
+        uint32_t bit = 1u << t;
+        if (!(load_tasks[t].after & ~done) && !(atomic_fetch_or(&load.claimed, bit) & bit))
+            return t;
+    }
+    return -1;
+}
+static void load_run(LoadTask t) {
+    TRACE_BEGIN(load_tasks[t].name);
+    load_tasks[t].run();
+    TRACE_END(load_tasks[t].name);
+    atomic_fetch_or(&load.done, 1u << t);
+}
+
+#ifndef _MSC_VER
+static void *load_worker(void *arg) {
+    (void)arg;
+    while (atomic_load(&load.claimed) != LOAD_ALL) {
+        int t = load_claim();
+        if (t >= 0) load_run(t);
+        else usleep(200); /* the rest are waiting on a task someone else has */
+    }
+    return NULL;
+}
+#endif
+
+static void load_start(void) {
+#ifndef _MSC_VER
+    /* without thread support (emscripten built without -pthread) this gets none */
+    for (; load.nthread < LOADER_THREADS; load.nthread++)
+        if (pthread_create(load.threads + load.nthread, NULL, load_worker, NULL)) break;
+#endif
+}
+
+/* called by frame() until it returns 1, which is once everything is loaded and
+ * on the gpu. uploads what it can of what has landed since the last call */
+static int load_poll(void) {
+    if (load.interactive) return 1;
+    if (!load.nthread) {
+        int t = load_claim();
+        if (t >= 0) load_run(t);
+    }
+
+    uint32_t done = atomic_load(&load.done);
+    if ((done & (1u << LoadTask_Font)) && !(load.landed & LoadLanded_Font)) {
+        load.landed |= LoadLanded_Font;
+        sg_destroy_image(state.dyn_geo.bind.fs_images[SLOT_tex]);
+        state.dyn_geo.bind.fs_images[SLOT_tex] =
+        state.static_geo.bind.fs_images[SLOT_tex] =
+        glyphs.img = sg_make_image(&(sg_image_desc){
+            .width = GLYPH_ATLAS,
+            .height = GLYPH_ATLAS,
+            .usage = SG_USAGE_DYNAMIC,
+            .pixel_format = SG_PIXELFORMAT_R8,
+            .label = "font-texture"
+        });
+    }
+    uint32_t chunks_after = (1u << LoadTask_Map) | (1u << LoadTask_Pack);
+    if ((done & chunks_after) == chunks_after && !(load.landed & LoadLanded_Chunks)) {
+        load.landed |= LoadLanded_Chunks;
+        if (!load.pack || !asset_pack_load_chunks(load.pack))
+            map_chunks_rebuild_all();
+    }
+
+    /* the first frame always shows the loading bar, so it's been timed by now */
+    if (done != LOAD_ALL || load.landed != LoadLanded_All || !load.first_frame) return 0;
+
+#ifndef _MSC_VER
+    for (int i = 0; i < load.nthread; i++) pthread_join(load.threads[i], NULL);
+#endif
+    if (load.pack) file_unmap(load.pack, load.pack_size);
+    load.pack = NULL;
+
+    load.interactive = stm_since(load.start);
+    fprintf(stderr, "first frame after %.1fms, interactive after %.1fms on %d loader threads\n",
+            stm_ms(load.first_frame), stm_ms(load.interactive), load.nthread);
+    mem_report();
+    return 1;
+}
+
+/* a bar across the middle of the screen, in pixels, filling as things land */
+static void write_loading(GeoWtr *wtr) {
+    int steps = __builtin_popcount(atomic_load(&load.done)) + __builtin_popcount(load.landed);
+    float w = sapp_widthf() / 3.0f, h = 12.0f,
+          x = sapp_widthf() / 2.0f, y = sapp_heightf() / 2.0f - h/2.0f,
+          fill = w * steps / (LoadTask_COUNT + __builtin_popcount(LoadLanded_All));
+    write_rect(wtr, x, y, w + 4.0f, h + 4.0f, Color_DarkSlotColor, 0.0f);
+    write_rect(wtr, x - w/2.0f + fill/2.0f, y + 2.0f, fill, h, Color_Beige, 0.0f);
 }
 
 static void init(void) {
-    state.player = ent_alloc();
-    state.player->has_mask = EntMask_Player;
-    state.player->hit_mask = ~EntMask_Player;
-    state.player->item_hit_mask = EntMask_Enemy;
-    state.player->looks = EntLooks_Player;
-    state.player->item = EntItem_Bow;
-    state.player->hp = 15;
-    state.player->radius = 0.2f;
+    stm_setup();
+    load.start = stm_now();
+
+    mem_init();
+    state.world = ARENA_ARRAY(mem + Mem_Ents, World, 1);
+    state.parts = ARENA_ARRAY(mem + Mem_Ents, Parts, 1);
+    state.ui = ARENA_ARRAY(mem + Mem_Ui, UiState, 1);
+
+    state.zoom = GAME_SCALE;
+    world_init(state.world, &state.level);
+    state.world->parts = state.parts;
 
     ui_init();
 
@@ -1005,51 +3360,25 @@ static void init(void) {
         { 5.0f + 5.0f, 2.0f, 0.7f },
         { 5.0f + 4.0f, 5.0f, 0.5f },
     };
-    for (int i = 0; i < sizeof(pots) / sizeof(pots[0]); i++) {
-        Ent *pot = ent_alloc();
-        pot->pos = vec2(pots[i].x, pots[i].y);
-        pot->radius = pots[i].radius;
-        pot->looks = EntLooks_Pot;
-        pot->item = EntItem_Sword;
-        pot->has_mask = EntMask_Enemy;
-        pot->hit_mask = ~0;
-        pot->item_hit_mask = EntMask_Player;
-        pot->hostile = 1;
-        pot->hp = 3;
-    }
+    for (int i = 0; i < sizeof(pots) / sizeof(pots[0]); i++)
+        ent_spawn_pot(state.world, vec2(pots[i].x, pots[i].y), pots[i].radius);
 
-    stm_setup();
-    sg_setup(&(sg_desc){ .context = sapp_sgcontext() });
-
-    state.map = parse_map_data(fopen("build/map.bytes", "rb"));
-    state.static_geo = geo_alloc(1 << 16, 1 << 18);
-    state.static_geo_n_idx = write_map(&state.static_geo);
-    geo_bind_init(&state.static_geo, "static_vert", "static_idx", SG_USAGE_IMMUTABLE);
-    free(state.static_geo.verts);
-    free(state.static_geo.idxs);
-
-#define map (state.map)
-    for (MapData_Circle *t = map.circles; (t - map.circles) < map.ncircles; t++) {
-        Ent *circ = ent_alloc();
-        circ->has_mask = EntMask_Terrain;
-        circ->hit_mask = 0;
-        circ->radius = t->radius;
-        circ->pos = vec2(t->x, t->y);
-    }
-#undef map
+    state.static_geo = geo_alloc(mem + Mem_StaticGeo, STATIC_GEO_NVERT, STATIC_GEO_NIDX);
+    state.dyn_geo = geo_alloc(mem + Mem_DynGeo, DYN_GEO_NVERT, DYN_GEO_NIDX);
+    state.part_geo = geo_alloc(mem + Mem_DynGeo, PART_GEO_NVERT, PART_GEO_NVERT);
+    load_start();
 
-    state.dyn_geo = geo_alloc(1 << 15, 1 << 17);
+    sg_setup(&(sg_desc){
+        .buffer_pool_size = MAP_CHUNK_MAX*2 + 16,
+        .context = sapp_sgcontext()
+    });
     geo_bind_init(&state.dyn_geo, "dyn_vert", "dyn_idx", SG_USAGE_STREAM);
+    geo_bind_init(&state.part_geo, "part_vert", "part_idx", SG_USAGE_STREAM);
 
-    uint8_t palette[8*8*4] = {0}, *plt_wtr = palette;
-
-#define X(name, r, g, b, a) \
-    *plt_wtr++ = (uint8_t)(r * 255.0); \
-    *plt_wtr++ = (uint8_t)(g * 255.0); \
-    *plt_wtr++ = (uint8_t)(b * 255.0); \
-    *plt_wtr++ = (uint8_t)(a * 255.0); 
-    PALETTE
-#undef X
+    /* the loading bar needs the palette, and it's only a table; the pack's copy
+     * is the same one */
+    uint8_t palette[8*8*4];
+    palette_bake(palette);
     
     /* NOTE: tex_slot is provided by shader code generation */
     state.static_geo.bind.fs_images[SLOT_palette] =
@@ -1060,28 +3389,24 @@ static void init(void) {
         .label = "palette-texture"
     });
 
-    /* -- font tex init -- */
-    unsigned char ttf_buffer[1<<20];
-    unsigned char temp_bitmap[512*512];
-    if (!fread(ttf_buffer, 1, 1<<20, fopen("./WackClubSans-Regular.ttf", "rb")))
-        perror("couldn't get font");
-    // no guarantee this fits!
-    stbtt_BakeFontBitmap(ttf_buffer,0, 24.0, temp_bitmap,512,512, 32,96, cdata);
-    temp_bitmap[0] = 255;
+    /* glyphs_clear() makes the atlas's first texel solid for untextured geometry,
+     * which is all this has until load_poll() swaps the atlas in */
+    uint8_t solid = 255;
     state.dyn_geo.bind.fs_images[SLOT_tex] =
     state.static_geo.bind.fs_images[SLOT_tex] = sg_make_image(&(sg_image_desc){
-        .width = 512,
-        .height = 512,
+        .width = 1,
+        .height = 1,
         .pixel_format = SG_PIXELFORMAT_R8,
-        .data.subimage[0][0] = SG_RANGE(temp_bitmap),
-        .label = "font-texture"
+        .data.subimage[0][0] = SG_RANGE(solid),
+        .label = "solid-texture"
     });
 
     /* create shader from code-generated sg_shader_desc */
     sg_shader shd = sg_make_shader(triangle_shader_desc(sg_query_backend()));
 
-    /* create a pipeline object (default render states are fine for triangle) */
-    state.pip = sg_make_pipeline(&(sg_pipeline_desc){
+    /* the palette is all opaque and untextured geometry samples the atlas's solid
+     * texel, so only text has anything to blend */
+    sg_pipeline_desc pip_desc = {
         .shader = shd,
         .index_type = SG_INDEXTYPE_UINT16,
         .layout = {
@@ -1091,19 +3416,26 @@ static void init(void) {
                 [ATTR_vs_uv0].format = SG_VERTEXFORMAT_FLOAT2,
             }
         },
-        .colors[0].blend = (sg_blend_state) {
-            .enabled = true,
-            .src_factor_rgb = SG_BLENDFACTOR_ONE, 
-            .dst_factor_rgb = SG_BLENDFACTOR_ONE_MINUS_SRC_ALPHA, 
-            .src_factor_alpha = SG_BLENDFACTOR_ONE, 
-            .dst_factor_alpha = SG_BLENDFACTOR_ONE_MINUS_SRC_ALPHA,
-        },
         .depth = {
             .compare = SG_COMPAREFUNC_LESS_EQUAL,
             .write_enabled = true
         },
         .label = "default-pipeline"
-    });
+    };
+    state.pip = sg_make_pipeline(&pip_desc);
+
+    /* the hud is all one z and layered by the order it's written in, so it's
+     * drawn as it is, after everything it can show through to */
+    pip_desc.colors[0].blend = (sg_blend_state) {
+        .enabled = true,
+        .src_factor_rgb = SG_BLENDFACTOR_ONE, 
+        .dst_factor_rgb = SG_BLENDFACTOR_ONE_MINUS_SRC_ALPHA, 
+        .src_factor_alpha = SG_BLENDFACTOR_ONE, 
+        .dst_factor_alpha = SG_BLENDFACTOR_ONE_MINUS_SRC_ALPHA,
+    };
+    pip_desc.depth.write_enabled = false;
+    pip_desc.label = "blend-pipeline";
+    state.blend_pip = sg_make_pipeline(&pip_desc);
 
     /* a pass action to framebuffer to black */
     state.pass_action = (sg_pass_action) {
@@ -1111,31 +3443,32 @@ static void init(void) {
     };
 }
 
-static int ent_swing(Ent *e, Vec2 toward) {
-    int can_swing = state.tick > e->swing.end;
+static int ent_swing(World *w, Ent *e, Vec2 toward) {
+    int can_swing = !ent_has(w, e, COMP(Swinging));
     if (can_swing)
         e->swing.shot = 0,
-        e->swing.end = state.tick + item_attack_duration[e->item],
-        e->swing.toward = norm2(toward);
+        e->swing.toward = norm2(toward),
+        ent_swing_until(w, e, w->tick + item_attack_duration[e->item]);
     return can_swing;
 }
 
-static void ent_item_transform(Ent *e, float *out_rot, Vec2 *out_pos, uint8_t *out_dmg) {
-    Vec2 toward = e->swing.toward;
-    Vec2 center = vec2(0.0f, 0.5f);
-    Vec2 hand_pos = add2(center, mul2f(toward, 0.5f));
+/* worked out the first time it's asked for in a tick, which is tick() looking
+ * for damage; drawing the ent reuses that */
+static ItemPose *ent_item_pose(World *w, Ent *e) {
+    ItemPose *pose = &e->pose;
+    if (pose->fresh == w->tick + 1) return pose;
+    pose->fresh = w->tick + 1;
 
-    float rot = vec2_rads(e->swing.toward) + item_rot_offset[e->item];
-    float dir = signum(e->swing.toward.x) ?: 1.0f;
+    Vec2 toward = e->swing.toward;
+    float dir = signum(toward.x) ?: 1.0f;
 
     float rest_rot;
     Vec2 rest_pos;
     {
         float vl = mag2(e->vel);
-        float tickf = state.tick;
         float drag = fminf(vl, 0.07f);
-        float breathe = sinf(tickf / 35.0f) / 30.0f;
-        float jog = sinf(tickf / 6.85f) * fminf(vl, 0.175f);
+        float breathe = w->idle.breathe;
+        float jog = w->idle.jog * fminf(vl, 0.175f);
         float x_offset = item_x_offset[e->item];
         rest_rot = -(M_PI_2 + breathe + jog);
         if (!item_always_point_down[e->item]) rest_rot *= dir;
@@ -1143,61 +3476,36 @@ static void ent_item_transform(Ent *e, float *out_rot, Vec2 *out_pos, uint8_t *o
         rest_pos.y = 0.35 + (breathe + jog) / 2.8 + drag * 0.5;
     }
 
-    *out_rot = rest_rot;
-    *out_pos = rest_pos;
-    if (out_dmg) *out_dmg = 0;
-
-    float time = (e->swing.end - state.tick) / ((float) item_attack_duration[e->item]);
-    if (time > 0.0f) {
-        typedef enum {
-            KF_Rotates = (1 << 1),
-            KF_Moves   = (1 << 2),
-            KF_Damages = (1 << 3),
-        } KF_Flag;
-        typedef struct { float duration; KF_Flag flags; float rot; Vec2 pos; } KF;
-
-        float swing = 0.5f * dir;
-#define FRAME_COUNT (5)
-        KF frames[FRAME_COUNT] = {0};
-        KF *f = frames;
-
-        if (e->item == EntItem_Sword) {
-            *f++=(KF){0.2174f,              KF_Rotates | KF_Moves, rot-swing * 1.f, hand_pos};
-            *f++=(KF){0.2304f,              KF_Rotates           , rot-swing * 2.f,         };
-            *f++=(KF){0.0870f, KF_Damages | KF_Rotates           , rot+swing * 2.f,         };
-            *f++=(KF){0.2478f,              KF_Rotates           , rot+swing * 3.f,         };
-            *f++=(KF){0.2174f,              KF_Rotates | KF_Moves,        rest_rot, rest_pos};
-        }
-        if (e->item == EntItem_Bow) {
-            /* ready, backup, FIRE, recover, return */
-            *f++=(KF){0.2703f,              KF_Moves | KF_Rotates,       rot, hand_pos};
-            *f++=(KF){0.2703f,              KF_Moves             ,      0.0f, hand_pos};
-            *f++=(KF){0.0541f, KF_Damages | KF_Moves             ,      0.0f, hand_pos};
-            *f++=(KF){0.1351f,              KF_Moves             ,      0.0f, hand_pos};
-            *f++=(KF){0.2703f,              KF_Moves | KF_Rotates,  rest_rot, rest_pos};
-            frames[1].pos = sub2(hand_pos, mul2f(toward, 0.2f));
-            frames[2].pos = sub2(hand_pos, mul2f(toward, 0.6f));
-        };
+    pose->rot = rest_rot;
+    pose->pos = rest_pos;
+    pose->dmg = 0;
 
-        for (KF *f = frames; (f - frames) < FRAME_COUNT; f++) {
-            if (time > f->duration) {
-                time -= f->duration;
-                if (f->flags & KF_Rotates) *out_rot = f->rot;
-                if (f->flags & KF_Moves) *out_pos = f->pos;
-                continue;
-            };
+    float time = (e->swing.end - w->tick) / ((float) item_attack_duration[e->item]);
+    if (time <= 0.0f) return pose;
 
-            float t = time / f->duration;
-            if (f->flags & KF_Rotates) *out_rot = lerp_rads(*out_rot, f->rot, t);
-            if (f->flags & KF_Moves) *out_pos = lerp2(*out_pos, f->pos, t);
-            if (f->flags & KF_Damages && out_dmg) *out_dmg = 1;
-            break;
-        }
-    }
-#undef FRAME_COUNT
+    Vec2 hand_pos = add2(vec2(0.0f, 0.5f), mul2f(toward, 0.5f));
+    float aim = vec2_rads(toward) + item_rot_offset[e->item];
+    float swing = 0.5f * dir;
+
+    for (const AnimKey *k = item_anim[e->item]; (k - item_anim[e->item]) < ITEM_ANIM_KEYS; k++) {
+        float rot = (k->rot == AnimRot_Aim)  ? aim + swing * k->swings :
+                    (k->rot == AnimRot_Rest) ? rest_rot : 0.0f;
+        Vec2 pos = (k->pos == AnimPos_Rest) ? rest_pos : sub2(hand_pos, mul2f(toward, k->pull));
+
+        if (time > k->duration) {
+            time -= k->duration;
+            if (k->flags & AnimKey_Rotates) pose->rot = rot;
+            if (k->flags & AnimKey_Moves) pose->pos = pos;
+            continue;
+        };
 
-    out_pos->x += e->pos.x;
-    out_pos->y += e->pos.y;
+        float t = time / k->duration;
+        if (k->flags & AnimKey_Rotates) pose->rot = lerp_rads(pose->rot, rot, t);
+        if (k->flags & AnimKey_Moves) pose->pos = lerp2(pose->pos, pos, t);
+        if (k->flags & AnimKey_Damages) pose->dmg = 1;
+        break;
+    }
+    return pose;
 }
 
 static Vec2 ui_box_pos(UiBox *box) {
@@ -1228,7 +3536,7 @@ static UiBox *ui_box_at_pos(Vec2 pos, UiBoxProp mask) {
     return ret;
 }
 
-static void write_ent(GeoWtr *wtr, Ent *e) {
+static void write_ent(GeoWtr *wtr, World *w, Ent *e) {
     switch (e->looks) {
         case EntLooks_None: break;
         case EntLooks_Player: {
@@ -1237,16 +3545,12 @@ static void write_ent(GeoWtr *wtr, Ent *e) {
         case EntLooks_Pot: {
             write_pot(wtr, e->pos.x, e->pos.y, e->radius);
         } break;
-        case EntLooks_Arrow: {
-            write_arrow(wtr, vec2_rads(e->vel), e->pos.x, e->pos.y, e->pos.y);
-        } break;
     }
 
     if (e->item) {
-        float im_rot;
-        Vec2 im_pos;
-        ent_item_transform(e, &im_rot, &im_pos, NULL);
-        write_item(wtr, im_rot, im_pos, e, im_pos.y - 1.0f);
+        ItemPose *pose = ent_item_pose(w, e);
+        Vec2 im_pos = add2(e->pos, pose->pos);
+        write_item(wtr, w, pose->rot, im_pos, e, im_pos.y - 1.0f);
     }
 }
 
@@ -1269,14 +3573,14 @@ static void write_ui(GeoWtr *wtr) {
             write_text(wtr, x - 70.0f, y + 100.0f, msg, Color_White);
 
 
-            Ent player = *state.player;
+            Ent player = *state.world->player;
             player.pos = (Vec2){0};
 
             float scale = 40.0f;
             Vec2 offset = {{ -75.0f, -66.0f }};
 
             Vert *vert0 = wtr->vert;
-            write_ent(wtr, &player);
+            write_ent(wtr, state.world, &player);
             for (Vert *i = vert0; i < wtr->vert; i++)
                 i->x = i->x * scale + pos.x + offset.x + hsize,
                 i->y = i->y * scale + pos.y + offset.y + hsize,
@@ -1300,14 +3604,14 @@ static void write_ui(GeoWtr *wtr) {
             Ent ent = { .item = box->item };
 
             Vert *vert0 = wtr->vert;
-            write_item(wtr, -M_2_PI, (Vec2){0}, &ent, 0.0f);
+            write_item(wtr, state.world, -M_2_PI, (Vec2){0}, &ent, 0.0f);
             for (Vert *i = vert0; i < wtr->vert; i++)
                 i->x =  i->x * scale + pos.x + offset.x + hsize + 2,
                 i->y =  i->y * scale + pos.y + offset.y + hsize - 2,
                 i->color = Color_DarkSlotColor;
 
             vert0 = wtr->vert;
-            write_item(wtr, -M_2_PI, (Vec2){0}, &ent, 0.0f);
+            write_item(wtr, state.world, -M_2_PI, (Vec2){0}, &ent, 0.0f);
             for (Vert *i = vert0; i < wtr->vert; i++)
                 i->x =  i->x * scale + pos.x + offset.x + hsize,
                 i->y =  i->y * scale + pos.y + offset.y + hsize;
@@ -1316,30 +3620,104 @@ static void write_ui(GeoWtr *wtr) {
     }
 }
 
+static void input_pending(InputPending *p) {
+    if (p->n < INPUT_PENDING_MAX) p->at[p->n++] = stm_now();
+}
+/* every event in p is on screen as of now */
+static void input_shown(InputPending *p, uint64_t now) {
+    LatencyHist *h = state.input.hist + state.input.late;
+    for (int i = 0; i < p->n; i++) {
+        double ms = stm_ms(stm_diff(now, p->at[i]));
+        int b = (int)(ms / LATENCY_BUCKET_MS);
+        h->bucket[(b < LATENCY_BUCKETS) ? b : LATENCY_BUCKETS - 1]++;
+        h->n++;
+        h->max_ms = fmax(h->max_ms, ms);
+    }
+    p->n = 0;
+}
+
+/* to stderr, on F4 and on the way out */
+static void latency_report(void) {
+    for (int late = 0; late < 2; late++) {
+        LatencyHist *h = state.input.hist + late;
+        if (!h->n) continue;
+
+        double pct[] = { 0.5, 0.9, 0.99 }, at[3];
+        uint32_t seen = 0;
+        for (int b = 0, p = 0; b < LATENCY_BUCKETS && p < 3; b++)
+            for (seen += h->bucket[b]; p < 3 && seen >= pct[p] * h->n; p++)
+                at[p] = fmin((b + 1) * LATENCY_BUCKET_MS, h->max_ms);
+        fprintf(stderr, "input to commit, late sampling %s: %u events, p50 %.1fms p90 %.1fms p99 %.1fms max %.1fms\n",
+                late ? "on" : "off", h->n, at[0], at[1], at[2], h->max_ms);
+
+        /* 2ms to a row */
+        uint32_t rows[LATENCY_BUCKETS / 4] = {0}, most = 1;
+        for (int b = 0; b < LATENCY_BUCKETS; b++) rows[b / 4] += h->bucket[b];
+        for (int r = 0; r < LATENCY_BUCKETS / 4; r++) if (rows[r] > most) most = rows[r];
+        for (int r = 0; r < LATENCY_BUCKETS / 4; r++) {
+            if (!rows[r]) continue;
+            fprintf(stderr, "  %4.0f-%-4.0fms%s %6u %.*s\n",
+                    r * 4 * LATENCY_BUCKET_MS, (r + 1) * 4 * LATENCY_BUCKET_MS,
+                    (r == LATENCY_BUCKETS/4 - 1) ? "+" : " ", rows[r],
+                    (int)(40 * rows[r] / most), "########################################");
+        }
+    }
+}
+
+/* what world_input_from_keys reads, and attacking; the rest never reach the sim */
+static int key_is_game_input(sapp_keycode key) {
+    switch (key) {
+    case SAPP_KEYCODE_W: case SAPP_KEYCODE_A:
+    case SAPP_KEYCODE_S: case SAPP_KEYCODE_D:
+    case SAPP_KEYCODE_LEFT_SHIFT:
+    case SAPP_KEYCODE_SPACE: return 1;
+    default: return 0;
+    }
+}
+
 static void game_event(const sapp_event *ev) {
+    World *w = state.world;
     switch (ev->type) {
     case SAPP_EVENTTYPE_KEY_UP:
     case SAPP_EVENTTYPE_KEY_DOWN: {
         state.keys[ev->key_code] = ev->type == SAPP_EVENTTYPE_KEY_DOWN;
+        if (!ev->key_repeat && key_is_game_input(ev->key_code))
+            input_pending(&state.input.game);
         if (ev->key_code == SAPP_KEYCODE_ESCAPE)
             sapp_request_quit();
+        else if (ev->key_code == SAPP_KEYCODE_F2 && ev->type == SAPP_EVENTTYPE_KEY_DOWN)
+            mem_report();
+        else if (ev->key_code == SAPP_KEYCODE_F3 && ev->type == SAPP_EVENTTYPE_KEY_DOWN) {
+            if (TRACING) trace_stop();
+            else trace_start(TRACE_PATH);
+        }
+        else if (ev->key_code == SAPP_KEYCODE_F4 && ev->type == SAPP_EVENTTYPE_KEY_DOWN) {
+            latency_report();
+            state.input.late = !state.input.late;
+            fprintf(stderr, "late input sampling %s\n", state.input.late ? "on" : "off");
+        }
         else if (ev->key_code == SAPP_KEYCODE_SPACE) {
-            if (ev->type == SAPP_EVENTTYPE_KEY_UP && state.aimer.active) {
-                if (ent_swing(state.player, norm2(state.aimer.pos)))
-                    state.aimer.active = 0;
-            } else if (!state.aimer.active && state.tick > state.player->swing.end) {
-                state.aimer.active = 1,
-                state.aimer.pos = vec2(0.0f, 0.0f);
+            if (ev->type == SAPP_EVENTTYPE_KEY_UP && w->aimer.active) {
+                if (ent_swing(w, w->player, norm2(w->aimer.pos)))
+                    w->aimer.active = 0;
+            } else if (!w->aimer.active && !ent_has(w, w->player, COMP(Swinging))) {
+                w->aimer.active = 1,
+                w->aimer.pos = vec2(0.0f, 0.0f);
             }
         }
     } break;
     case SAPP_EVENTTYPE_MOUSE_DOWN: {
         Vec2 cam = state.cam;
         float ar = sapp_widthf() / sapp_heightf(); /* aspect ratio */
-        float x = -(1.0f - ev->mouse_x / sapp_widthf()  * 2.0f) * GAME_SCALE        + cam.x;
-        float y =  (1.0f - ev->mouse_y / sapp_heightf() * 2.0f) * (GAME_SCALE / ar) + cam.y;
-        if (state.tick > state.player->swing.end)
-            ent_swing(state.player, norm2(sub2(vec2(x, y), state.player->pos)));
+        float x = -(1.0f - ev->mouse_x / sapp_widthf()  * 2.0f) * state.zoom        + cam.x;
+        float y =  (1.0f - ev->mouse_y / sapp_heightf() * 2.0f) * (state.zoom / ar) + cam.y;
+        ent_swing(w, w->player, norm2(sub2(vec2(x, y), w->player->pos)));
+        input_pending(&state.input.game);
+    } break;
+    case SAPP_EVENTTYPE_MOUSE_SCROLL: {
+        input_pending(&state.input.ui);
+        state.zoom *= powf(1.1f, -ev->scroll_y);
+        state.zoom = fminf(fmaxf(state.zoom, GAME_SCALE * 0.5f), GAME_SCALE * 8.0f);
     } break;
     default: {}
     }
@@ -1355,44 +3733,47 @@ static void event(const sapp_event *ev) {
         UiBox *drag_start = ui_box_at_pos(mouse_pos, UiBoxProp_DragZone);
 
         if (hovered) {
-            if (drag_start) state.ui.drag_start_box = drag_start;
-            state.ui.grabbed = hovered;
+            if (drag_start) state.ui->drag_start_box = drag_start;
+            state.ui->grabbed = hovered;
+            input_pending(&state.input.ui);
             goto CAPTURE;
         }
     } break;
     case SAPP_EVENTTYPE_MOUSE_MOVE: {
-        if (state.ui.grabbed) {
-            state.ui.grabbed->pos.x += mouse_pos.x - state.ui.last_mouse.x;
-            state.ui.grabbed->pos.y += mouse_pos.y - state.ui.last_mouse.y;
-            // state.ui.grabbed->pos = mouse_pos;
+        if (state.ui->grabbed) {
+            state.ui->grabbed->pos.x += mouse_pos.x - state.ui->last_mouse.x;
+            state.ui->grabbed->pos.y += mouse_pos.y - state.ui->last_mouse.y;
+            // state.ui->grabbed->pos = mouse_pos;
+            input_pending(&state.input.ui);
             goto CAPTURE;
         }
     } break;
     case SAPP_EVENTTYPE_MOUSE_UP: {
-        if (state.ui.grabbed) {
-            if (state.ui.grabbed->props & UiBoxProp_LockDrop) {
+        if (state.ui->grabbed) {
+            if (state.ui->grabbed->props & UiBoxProp_LockDrop) {
                 UiBox *drop_zone = ui_box_at_pos(mouse_pos, UiBoxProp_DropZone);
 
                 if (drop_zone) {
                     /* see if there's another LockDrop at this pos that != us */
-                    state.ui.grabbed->props &= ~UiBoxProp_LockDrop;
+                    state.ui->grabbed->props &= ~UiBoxProp_LockDrop;
                     UiBox *other = ui_box_at_pos(mouse_pos, UiBoxProp_LockDrop);
-                    state.ui.grabbed->props |= UiBoxProp_LockDrop;
+                    state.ui->grabbed->props |= UiBoxProp_LockDrop;
 
-                    if (other) other->pos = state.ui.drag_start_box->pos;
+                    if (other) other->pos = state.ui->drag_start_box->pos;
 
-                    state.ui.grabbed->pos = drop_zone->pos;
+                    state.ui->grabbed->pos = drop_zone->pos;
 
-                    if (state.ui.player_weapon_slot == drop_zone)
-                        state.player->item = state.ui.grabbed->item;
-                    else if (state.ui.player_weapon_slot == state.ui.drag_start_box)
-                        state.player->item = other->item;
-                } else if (state.ui.drag_start_box) {
-                    state.ui.grabbed->pos = state.ui.drag_start_box->pos;
+                    if (state.ui->player_weapon_slot == drop_zone)
+                        ent_set_item(state.world, state.world->player, state.ui->grabbed->item);
+                    else if (state.ui->player_weapon_slot == state.ui->drag_start_box)
+                        ent_set_item(state.world, state.world->player, other->item);
+                } else if (state.ui->drag_start_box) {
+                    state.ui->grabbed->pos = state.ui->drag_start_box->pos;
                 }
             }
 
-            state.ui.grabbed = NULL;
+            state.ui->grabbed = NULL;
+            input_pending(&state.input.ui);
             goto CAPTURE;
         }
     } break;
@@ -1407,181 +3788,642 @@ CAPTURE:
     case SAPP_EVENTTYPE_MOUSE_DOWN:
     case SAPP_EVENTTYPE_MOUSE_MOVE:
     case SAPP_EVENTTYPE_MOUSE_UP:
-        state.ui.last_mouse = mouse_pos;
+        state.ui->last_mouse = mouse_pos;
     default: {}
     }
 }
 
-unsigned int positive_inf = 0x7F800000; // 0xFF << 23
-#define POS_INF_F (*(float *)&positive_inf)
-static float scene_distance(Vec2 p, Ent *exclude, EntMask hit_mask, Ent **ent) {
+/* what a scene query ran into; ent is NULL for terrain.
+ * normal points from the surface that was hit toward the query point */
+typedef struct { Ent *ent; Vec2 normal; } Hit;
+
+static float scene_distance(World *w, Vec2 p, Ent *exclude, EntMask hit_mask, Hit *hit) {
     float dist = POS_INF_F;
 
-    SYSTEM(e) {
+    if (hit_mask & EntMask_Terrain) {
+        Vec2 normal;
+        dist = terrain_distance_baked(&w->level->terrain, p, hit ? &normal : NULL);
+        if (hit && dist < POS_INF_F) *hit = (Hit) { .normal = normal };
+    }
+
+    if (!(hit_mask & ~EntMask_Terrain)) return dist;
+    QUERY(w, e, COMP(Collider)) {
         if (!(e->has_mask & hit_mask)) continue;
         if (e == exclude) continue;
 
-        float this_dist = dist2(p, e->pos) - e->radius;
+        float center_dist = dist2(p, e->pos);
+        float this_dist = center_dist - e->radius;
         if (this_dist < dist) {
             dist = this_dist;
-            if (ent) *ent = e;
+            if (hit) *hit = (Hit) {
+                .ent = e,
+                .normal = div2f(sub2(p, e->pos), center_dist ?: 1.0f)
+            };
         }
     }
     return dist;
 }
 
-static float raymarch(Vec2 origin, Vec2 dir, Ent *exclude, EntMask hit_mask, Ent **hit) {
+static float raymarch(World *w, Vec2 origin, Vec2 dir, Ent *exclude, EntMask hit_mask, Hit *hit) {
+    TRACE_BEGIN("raymarch");
     float t = 0.0f;
-    for (int iter = 0; iter < 5; iter++) {
-        float d = scene_distance(add2(origin, mul2f(dir, t)), exclude, hit_mask, hit);
-        if (d == POS_INF_F) return d;
-        if (d < 0.01f) return t;
+    int iter = 0, landed = 0;
+    while (iter < 5) {
+        float d = scene_distance(w, add2(origin, mul2f(dir, t)), exclude, hit_mask, hit);
+        iter++;
+        if (d == POS_INF_F) { t = d; break; }
+        if (d < 0.01f) { landed = 1; break; }
         t += d;
     }
+    TRACE_END_ARGS("raymarch", "iters", iter, "hit", landed);
     return t;
 }
 
-static float raymarch_ent(Ent *ent, Ent **hit) {
-    return raymarch(ent->pos, ent->vel, ent, ent->hit_mask, hit);
+/* only against the terrain; running into other ents is left to contacts_solve() */
+static float raymarch_ent(World *w, Ent *ent, Hit *hit) {
+    return raymarch(w, ent->pos, ent->vel, ent, ent->hit_mask & EntMask_Terrain, hit);
 }
 
 
-#define TICK_MS (1000.0f / 60.0f)
-static void tick(void) {
-    state.tick++;
+/* flies every projectile, only reading the ents; what they hit is
+ * applied afterwards, so one impact can't change what another one sees */
+static void projs_update(World *w) {
+    typedef struct { int proj; Edx hit; } Impact;
+    Impact impacts[PROJ_MAX];
+    int nimpact = 0;
+
+    /* what they could hit, gathered once for the whole pass */
+    typedef struct { Vec2 pos; float radius; EntMask has_mask; } Target;
+    Target targets[ENT_MAX];
+    int ntarget = 0;
+    QUERY(w, e, COMP(Collider))
+        targets[ntarget++] = (Target) { e->pos, e->radius, e->has_mask };
+
+    for (int i = 0; i < w->nproj; i++) {
+        Proj *p = w->projs + i;
+        float vel_mag = mag2(p->vel);
+
+        /* with nothing within a step there's nothing to march toward,
+         * which is where nearly all of them are nearly all of the time */
+        float near = (p->hit_mask & EntMask_Terrain)
+            ? terrain_distance_baked(&w->level->terrain, p->pos, NULL)
+            : POS_INF_F;
+        for (Target *t = targets; (t - targets) < ntarget; t++)
+            if (t->has_mask & p->hit_mask) near = fminf(near, dist2(p->pos, t->pos) - t->radius);
+        if (near >= vel_mag) {
+            p->pos = add2(p->pos, mul2f(norm2(p->vel), vel_mag));
+            continue;
+        }
+
+        float d;
+        Hit hit = {0};
+        float dist = raymarch(w, p->pos, p->vel, NULL, p->hit_mask, &hit);
+        if (dist <= 0.0f && hit.ent) {
+            impacts[nimpact++] = (Impact) { .proj = i, .hit = edx_from(w, hit.ent) };
+            continue;
+        } else if (dist <= 0.0f) {
+            parts_burst(w->parts, p->pos, hit.normal, 4, 0.04f, 0.05f, Color_LightishGrey);
+            p->vel = mul2f(refl2(norm2(p->vel), hit.normal), vel_mag);
+            d = vel_mag;
+        } else {
+            d = fminf(vel_mag, dist);
+        }
+        p->pos = add2(p->pos, mul2f(norm2(p->vel), d));
+    }
 
-    state.cam = lerp2(state.cam, add2(state.player->pos, vec2(0.0f, 0.5f)), 0.05f);
+    /* last first, so the projectile swapped into a removed one's place
+     * is never one that's still waiting on its impact */
+    for (int j = nimpact - 1; j >= 0; j--) {
+        Proj *p = w->projs + impacts[j].proj;
+        Ent *hit = edx_deref(w, impacts[j].hit); /* an earlier impact may have killed it */
+        if (hit && ent_damage(w, hit, edx_deref(w, p->owner)))
+            ent_push(w, hit, mul2f(p->vel, 0.4f));
+        parts_burst(w->parts, p->pos, norm2(p->vel), 6, 0.05f, 0.05f, Color_Beige);
+        *p = w->projs[--w->nproj];
+    }
+}
 
+#define TICK_MS (1000.0f / 60.0f)
+/* the only place the sim hears about the keyboard; keep key_is_game_input in step */
+static void world_input_from_keys(World *w) {
     Vec2 move = {0};
     if (state.keys[SAPP_KEYCODE_W]) move.y += 1.0;
     if (state.keys[SAPP_KEYCODE_S]) move.y -= 1.0;
     if (state.keys[SAPP_KEYCODE_A]) move.x -= 1.0;
     if (state.keys[SAPP_KEYCODE_D]) move.x += 1.0;
-    move = norm2(move);
-    float speed = ent_speed(state.player);
-    if (!state.keys[SAPP_KEYCODE_LEFT_SHIFT])
-        state.player->vel = add2(state.player->vel, mul2f(move, speed));
-    if (state.aimer.active) {
-        float aimer_speed = 0.08f * (1.0f + state.keys[SAPP_KEYCODE_LEFT_SHIFT]);
-        state.aimer.pos = add2(state.aimer.pos, mul2f(move, aimer_speed));
-    }
-
-    waffle_update(&state.waffle);
-
-    SYSTEM(e) {
-        if (e->item) {
-            float item_rot;
-            Vec2 item_pos;
-            uint8_t item_dmg;
-            ent_item_transform(e, &item_rot, &item_pos, &item_dmg);
-            if (item_shoots[e->item] && item_dmg && !e->swing.shot) {
-                e->swing.shot = 1;
-                e->vel = sub2(e->vel, mul2f(e->swing.toward, 0.145f));
-
-                Ent *blt = ent_alloc();
-                blt->pos = item_pos;
-                blt->looks = EntLooks_Arrow;
-                blt->vel = mul2f(e->swing.toward, 0.13f);
-                blt->hit_mask = e->item_hit_mask;
-                blt->friction = 1.0f;
-                blt->pointy = true;
+    w->input.move = norm2(move);
+    w->input.hold = state.keys[SAPP_KEYCODE_LEFT_SHIFT];
+}
+
+/* faster than the player and a hostile can close on each other, so one this
+ * much further off than AGGRO_DIST can't aggro for that many ticks */
+#define AGGRO_DIST (5.0f)
+#define AGGRO_CLOSING_SPEED (0.5f)
+
+/* cascades the slots coming up down a level, then fires this tick's */
+static void timers_fire(World *w) {
+    TimerWheel *tw = &w->timers;
+    for (int level = TIMER_LEVELS - 1; level > 0; level--) {
+        int bits = level * TIMER_SLOT_BITS;
+        if (w->tick & ((1ull << bits) - 1)) continue;
+
+        /* all due within the width of a slot here, so none land back in it */
+        uint16_t *slot = tw->slots + level * TIMER_SLOTS + ((w->tick >> bits) & (TIMER_SLOTS - 1));
+        for (uint16_t i = *slot, next; i; i = next)
+            next = tw->timers[i - 1].next, timer_link(w, i - 1);
+        *slot = 0;
+    }
+
+    uint16_t *due = tw->slots + (w->tick & (TIMER_SLOTS - 1));
+    while (*due) {
+        int i = *due - 1;
+        Timer t = tw->timers[i];
+        timer_unlink(w, i);
+        tw->timers[i].next = tw->free;
+        tw->free = i + 1;
+        /* an ent's timers are cancelled when it's freed, so this is always
+         * theirs; the gen check is there in case that's ever missed */
+        uint16_t *handle = timer_handle(w, t.kind, t.of);
+        if (*handle == i + 1) *handle = 0;
+
+        switch ((TimerKind)t.kind) {
+        case TimerKind_SwingEnd: {
+            Ent *e = edx_deref(w, t.of);
+            if (!e) break;
+            if (w->tick > e->swing.end) ent_comp_set(w, e, EntComp_Swinging, 0);
+            else timer_arm(w, t.kind, t.of, e->swing.end + 1);
+        } break;
+        case TimerKind_Aggro: {
+            Ent *e = edx_deref(w, t.of);
+            if (!e || !ent_has(w, e, COMP(Hostile)) || ent_has(w, e, COMP(Aggroed))) break;
+            float away = dist2(e->pos, w->player->pos) - AGGRO_DIST;
+            if (away < 0.0f && w->player->gen == 0)
+                ent_comp_set(w, e, EntComp_Aggroed, 1);
+            else
+                timer_arm(w, t.kind, t.of, w->tick + 1 + (Tick)(fmaxf(away, 0.0f) / AGGRO_CLOSING_SPEED));
+        } break;
+        case TimerKind_DmgLbl: {
+            DmgLbl *dl = w->dmg_lbls + t.of.idx;
+            if (w->tick - dl->tick >= DMG_LBL_TICKS) dl->tick = 0;
+            else timer_arm(w, t.kind, t.of, dl->tick + DMG_LBL_TICKS);
+        } break;
+        }
+    }
+}
+
+/* ents only march against the terrain when they move; overlaps between them are
+ * settled afterwards, all at once. the pairs touching anything that moved are
+ * found through a grid of the colliders, pushed apart over a few relaxation
+ * passes, and then however fast each pair is still closing is taken out of
+ * their velocities in one pass, so a crowd comes to rest packed together
+ * instead of bouncing off itself */
+#define CONTACT_CELL (1.5f)
+#define CONTACT_BUCKETS (1 << 10)
+#define CONTACT_MAX (ENT_MAX * 4) /* past this, pairs are left for the next tick */
+#define CONTACT_ITERS (4)
+#define CONTACT_SLOP (0.001f) /* overlap left alone, so resting pairs stay in contact */
+typedef struct {
+    uint16_t a, b;
+    float wa, wb; /* how much of the overlap each is moved to fix, 0 if it can't be */
+} Contact;
+
+static int contact_cell(float f) { return (int)floorf(f / CONTACT_CELL); }
+static int contact_bucket(int x, int y) {
+    return ((uint32_t)x * 73856093u ^ (uint32_t)y * 19349663u) % CONTACT_BUCKETS;
+}
+
+static void contacts_solve(World *w, uint64_t moved[ENT_MAX / 64]) {
+    TRACE_BEGIN("contacts_solve");
+    /* the colliders, bucketed the way ent_grid() does it */
+    uint16_t start[CONTACT_BUCKETS + 1] = {0}, ents[ENT_MAX], fill[CONTACT_BUCKETS];
+    float max_r = 0.0f;
+    QUERY(w, e, COMP(Collider)) {
+        start[contact_bucket(contact_cell(e->pos.x), contact_cell(e->pos.y)) + 1]++;
+        max_r = fmaxf(max_r, e->radius);
+    }
+    for (int b = 0; b < CONTACT_BUCKETS; b++) start[b + 1] += start[b];
+    memcpy(fill, start, sizeof(fill));
+    QUERY(w, e, COMP(Collider))
+        ents[fill[contact_bucket(contact_cell(e->pos.x), contact_cell(e->pos.y))]++] = e - w->ents;
+
+    Contact contacts[CONTACT_MAX];
+    int ncontact = 0;
+    uint16_t bodies[ENT_MAX];
+    int nbody = 0;
+    uint64_t in_body[ENT_MAX / 64] = {0};
+    for (int word = 0; word < ENT_MAX / 64; word++) {
+        for (uint64_t bits = moved[word]; bits; bits &= bits - 1) {
+            int ai = word * 64 + __builtin_ctzll(bits);
+            Ent *a = w->ents + ai;
+            if (!ent_has(w, a, COMP(Collider))) continue;
+
+            float reach = a->radius + max_r;
+            int x0 = contact_cell(a->pos.x - reach), x1 = contact_cell(a->pos.x + reach),
+                y0 = contact_cell(a->pos.y - reach), y1 = contact_cell(a->pos.y + reach);
+            int nx = x1 - x0 + 1, ny = y1 - y0 + 1;
+            int all = (int64_t)nx * ny >= CONTACT_BUCKETS;
+            uint64_t seen[CONTACT_BUCKETS / 64] = {0};
+            for (int c = 0; c < (all ? CONTACT_BUCKETS : nx * ny); c++) {
+                int bk = all ? c : contact_bucket(x0 + c % nx, y0 + c / nx);
+                if (seen[bk / 64] & (1ull << (bk % 64))) continue;
+                seen[bk / 64] |= 1ull << (bk % 64);
+
+                for (int i = start[bk]; i < start[bk + 1]; i++) {
+                    int bi = ents[i];
+                    /* a pair of movers is only taken from the lower one's side */
+                    if (bi == ai || (bi < ai && (moved[bi / 64] & (1ull << (bi % 64))))) continue;
+                    Ent *b = w->ents + bi;
+                    if (dist2(a->pos, b->pos) >= a->radius + b->radius) continue;
+
+                    int ya = !!(a->hit_mask & b->has_mask), yb = !!(b->hit_mask & a->has_mask);
+                    if (!ya && !yb) continue;
+                    if (ncontact == CONTACT_MAX) goto SOLVE;
+                    contacts[ncontact++] = (Contact) {
+                        ai, bi, ya / (float)(ya + yb), yb / (float)(ya + yb)
+                    };
+                    int pair[2] = { ai, bi };
+                    for (int *p = pair; p < pair + 2; p++)
+                        if (!(in_body[*p / 64] & (1ull << (*p % 64))))
+                            in_body[*p / 64] |= 1ull << (*p % 64), bodies[nbody++] = *p;
+                }
             }
-            if (item_hits  [e->item] && item_dmg) {
-                Vec2 dir = rads2(item_rot + M_PI_2);
-                Ent *hit;
-                if (raymarch(item_pos, dir, NULL, e->item_hit_mask, &hit) < 1.5f) {
-                    if (ent_damage(hit, e)) {
-                        Vec2 normal = norm2(sub2(e->pos, hit->pos));
-                        e->vel = add2(e->vel, mul2f(normal, 0.07f));
-                        hit->vel = add2(hit->vel, mul2f(normal, -0.2f));
-                    }
+        }
+    }
+
+SOLVE:
+    for (int iter = 0; iter < CONTACT_ITERS; iter++) {
+        for (Contact *c = contacts; (c - contacts) < ncontact; c++) {
+            Ent *a = w->ents + c->a, *b = w->ents + c->b;
+            Vec2 n = sub2(b->pos, a->pos);
+            float d = mag2(n);
+            float overlap = a->radius + b->radius - d - CONTACT_SLOP;
+            if (overlap <= 0.0f) continue;
+            n = d ? div2f(n, d) : vec2(1.0f, 0.0f); /* right on top of each other */
+            a->pos = sub2(a->pos, mul2f(n, overlap * c->wa));
+            b->pos = add2(b->pos, mul2f(n, overlap * c->wb));
+        }
+        /* and back out of any terrain that pushed them into */
+        for (uint16_t *i = bodies; (i - bodies) < nbody; i++) {
+            Ent *e = w->ents + *i;
+            if (!(e->hit_mask & EntMask_Terrain)) continue;
+            Vec2 normal;
+            float d = terrain_distance_baked(&w->level->terrain, e->pos, &normal) - e->radius;
+            if (d < 0.0f) e->pos = sub2(e->pos, mul2f(normal, d));
+        }
+    }
+
+    /* from the velocities they came in with, so no pair sees another's fix */
+    Vec2 dv[ENT_MAX];
+    for (uint16_t *i = bodies; (i - bodies) < nbody; i++) dv[*i] = vec2(0.0f, 0.0f);
+    for (Contact *c = contacts; (c - contacts) < ncontact; c++) {
+        Ent *a = w->ents + c->a, *b = w->ents + c->b;
+        Vec2 n = sub2(b->pos, a->pos);
+        float d = mag2(n);
+        if (d >= a->radius + b->radius || !d) continue;
+        n = div2f(n, d);
+        float closing = dot2(sub2(b->vel, a->vel), n);
+        if (closing >= 0.0f) continue;
+        dv[c->a] = add2(dv[c->a], mul2f(n, closing * c->wa));
+        dv[c->b] = sub2(dv[c->b], mul2f(n, closing * c->wb));
+    }
+    for (uint16_t *i = bodies; (i - bodies) < nbody; i++)
+        ent_push(w, w->ents + *i, dv[*i]);
+    TRACE_END_ARGS("contacts_solve", "pairs", ncontact, "bodies", nbody);
+}
+
+#define ENT_REST_SPEED (0.0001f) /* slower than this, and you've stopped */
+/* steps one world; everything it reads from outside the world is in w->input */
+static void tick(World *w) {
+    TRACE_BEGIN("tick");
+    w->tick++;
+    timers_fire(w);
+    sim_retier(w);
+    w->idle.breathe = sinf(w->tick / 35.0f) / 30.0f;
+    w->idle.jog = sinf(w->tick / 6.85f);
+
+    Vec2 move = w->input.move;
+    float speed = ent_speed(w->player);
+    if (!w->input.hold)
+        ent_push(w, w->player, mul2f(move, speed));
+    if (w->aimer.active) {
+        float aimer_speed = 0.08f * (1.0f + w->input.hold);
+        w->aimer.pos = add2(w->aimer.pos, mul2f(move, aimer_speed));
+    }
+
+    TRACE_BEGIN("waffle_update");
+    waffle_update(w);
+    TRACE_END("waffle_update");
+    if (w->parts) parts_update(w->parts);
+
+    QUERY(w, e, COMP(HasItem) | COMP(Swinging)) {
+        ItemPose *pose = ent_item_pose(w, e);
+        float item_rot = pose->rot;
+        Vec2 item_pos = add2(e->pos, pose->pos);
+        uint8_t item_dmg = pose->dmg;
+        if (item_shoots[e->item] && item_dmg && !e->swing.shot) {
+            e->swing.shot = 1;
+            ent_push(w, e, mul2f(e->swing.toward, -0.145f));
+
+            proj_spawn(w, item_pos, mul2f(e->swing.toward, 0.13f), edx_from(w, e), e->item_hit_mask);
+        }
+        if (item_hits  [e->item] && item_dmg) {
+            Vec2 dir = rads2(item_rot + M_PI_2);
+            Hit hit = {0};
+            if (raymarch(w, item_pos, dir, NULL, e->item_hit_mask, &hit) < 1.5f && hit.ent) {
+                if (ent_damage(w, hit.ent, e)) {
+                    Vec2 normal = norm2(sub2(e->pos, hit.ent->pos));
+                    ent_push(w, e, mul2f(normal, 0.07f));
+                    ent_push(w, hit.ent, mul2f(normal, -0.2f));
                 }
             }
         }
+    }
+
+    uint64_t moved[ENT_MAX / 64] = {0};
+    QUERY(w, e, COMP(Moving) | COMP(Awake)) {
+        int steps = sim_steps(w, e);
+        if (!steps) continue;
 
         float vel_mag = mag2(e->vel);
-        if (vel_mag <= 0.0f) continue;
+        if (vel_mag <= ENT_REST_SPEED) {
+            e->vel = vec2(0.0f, 0.0f);
+            ent_comp_set(w, e, EntComp_Moving, 0);
+            continue;
+        }
 
         float d;
-        Ent *closest_ent;
-        float closest_dist = raymarch_ent(e, &closest_ent) - e->radius;
+        Hit closest = {0};
+        float closest_dist = raymarch_ent(w, e, &closest) - e->radius;
         if (closest_dist <= 0.0f) {
-            /* by moving forward we'd hit a thing, if we're an arrow that means damage */
-            if (e->pointy && closest_ent) {
-                if (ent_damage(closest_ent, e))
-                    closest_ent->vel = add2(closest_ent->vel, mul2f(e->vel, 0.4f));
-                ent_free(e);
-                return;
-            }
-
-            /* otherwise let's just bounce off of that thing */
-            e->vel = mul2f(refl2(norm2(e->vel), norm2(sub2(e->pos, closest_ent->pos))), vel_mag);
-            d = vel_mag;
+            /* by moving forward we'd hit terrain, so let's just bounce off of it */
+            e->vel = mul2f(refl2(norm2(e->vel), closest.normal), vel_mag);
+            d = vel_mag * steps;
 
         } else {
-            d = fminf(vel_mag, closest_dist);
+            d = fminf(vel_mag * steps, closest_dist);
         }
 
         // e->pos = add2(e->pos, mul2f(e->vel, d / vel_mag));
         e->pos = add2(e->pos, mul2f(norm2(e->vel), d));
-        e->vel = mul2f(e->vel, e->friction ?: 0.93f);
+        float friction = e->friction ?: 0.93f;
+        e->vel = mul2f(e->vel, (steps == 1) ? friction : powf(friction, steps));
+        moved[(e - w->ents) / 64] |= 1ull << ((e - w->ents) % 64);
     }
+    contacts_solve(w, moved);
+
+    TRACE_BEGIN("projs_update");
+    projs_update(w);
+    TRACE_END("projs_update");
+    TRACE_END("tick");
 }
 
-static void frame(void) {
-    double elapsed = stm_ms(stm_laptime(&state.frame));
-    state.fixed_tick_accumulator += elapsed;
-    while (state.fixed_tick_accumulator > TICK_MS) {
-        state.fixed_tick_accumulator -= TICK_MS;
-        tick();
+/* one triangle a part, into a buffer of their own that always has room */
+static void write_parts(GeoWtr *wtr, Parts *p) {
+    TRACE_BEGIN("write_parts");
+    TRACE_COUNTER("parts", "live", p->count, NULL, 0);
+    Vert *v = wtr->vert;
+    uint16_t *idx = wtr->idx;
+    uint16_t start = v - wtr->geo->verts;
+    for (int i = 0; i < p->count; i++, start += 3) {
+        /* in front of whatever they flew out of */
+        float x = p->x[i], y = p->y[i], s = p->size[i], z = y - 1.0f;
+        *v++ = (Vert) { x - s, y - s * 0.6f, z, p->color[i] };
+        *v++ = (Vert) { x + s, y - s * 0.6f, z, p->color[i] };
+        *v++ = (Vert) { x,     y + s,        z, p->color[i] };
+        *idx++ = start + 0;
+        *idx++ = start + 1;
+        *idx++ = start + 2;
     }
+    wtr->vert = v;
+    wtr->idx = idx;
+    TRACE_END("write_parts");
+}
 
-    GeoWtr wtr = geo_wtr(&state.dyn_geo); 
+/* how far from its pos write_ent can draw e, counting its item */
+static float ent_visual_reach(Ent *e) {
+    float reach = 0.0f;
+    switch (e->looks) {
+        case EntLooks_None: break;
+        case EntLooks_Player: reach = 1.25f; break; /* a unit square, above pos */
+        case EntLooks_Pot: reach = e->radius * 1.45f; break;
+    }
+    /* bounded rather than posed, so ents off screen are never posed */
+    if (e->item) reach = fmaxf(reach, ITEM_HOLD_MAX + item_reach[e->item]);
+    return reach;
+}
+static int ent_grid_cell(float f) { return (int)floorf(f / ENT_GRID_CELL); }
+static int ent_grid_bucket(int x, int y) {
+    return ((uint32_t)x * 73856093u ^ (uint32_t)y * 19349663u) % ENT_GRID_BUCKETS;
+}
+static int ent_grid_bucket_of(Ent *e) {
+    return ent_grid_bucket(ent_grid_cell(e->pos.x), ent_grid_cell(e->pos.y));
+}
 
-    /* push game ents */
-    if (state.aimer.active) {
-        Vec2 p = add2(state.player->pos, state.aimer.pos);
-        write_sight(&wtr, p.x + 0.045f, p.y - 0.045f, 0.3f, Color_DarkMaroon, p.y - 1.0f);
-        write_sight(&wtr, p.x + 0.000f, p.y - 0.000f, 0.3f, Color_Maroon,     p.y - 1.0f);
+/* rebuilt the first time it's asked for in a tick; the ents only move in ticks,
+ * and whatever changes how far one draws between them drops the grid */
+static EntGrid *ent_grid(World *w) {
+    EntGrid *grid = &w->grid;
+    if (grid->fresh == w->tick + 1) return grid;
+    grid->fresh = w->tick + 1;
+    grid->reach = 0.0f;
+
+    memset(grid->start, 0, sizeof(grid->start));
+    QUERY(w, e, COMP(Renderable))
+        grid->start[ent_grid_bucket_of(e) + 1]++;
+    for (int b = 0; b < ENT_GRID_BUCKETS; b++)
+        grid->start[b + 1] += grid->start[b];
+
+    uint16_t fill[ENT_GRID_BUCKETS];
+    memcpy(fill, grid->start, sizeof(fill));
+    QUERY(w, e, COMP(Renderable)) {
+        int i = fill[ent_grid_bucket_of(e)]++;
+        grid->ents[i] = e - w->ents;
+        grid->reaches[i] = ent_visual_reach(e);
+        grid->reach = fmaxf(grid->reach, grid->reaches[i]);
     }
-    SYSTEM(e) {
-        if (!e->looks) continue;
-        write_ent(&wtr, e);
+    return grid;
+}
+
+/* game ents, in world space */
+static void write_world(GeoWtr *wtr, World *w) {
+    TRACE_BEGIN("write_world");
+    wtr->scale = view_scale();
+    if (w->aimer.active) {
+        Vec2 p = add2(w->player->pos, w->aimer.pos);
+        write_sight(wtr, p.x + 0.045f, p.y - 0.045f, 0.3f, Color_DarkMaroon, p.y - 1.0f);
+        write_sight(wtr, p.x + 0.000f, p.y - 0.000f, 0.3f, Color_Maroon,     p.y - 1.0f);
     }
 
-    uint16_t *text_start = wtr.idx;
-    { /* push text */
-        char buf[1 << 6];
-        sprintf(buf, "%d FPS", (int)roundf(1.0f / sapp_frame_duration()));
-        write_text(&wtr, sapp_widthf() - 90.0f, sapp_heightf(), buf, Color_White);
-
-        write_ui(&wtr);
-
-        for (int i = 0; i < sizeof(state.dmg_lbls) / sizeof(state.dmg_lbls[0]); i++) {
-            DmgLbl *dl = state.dmg_lbls + i;
-            float t = state.tick - dl->tick;
-            if (dmg_lbl_alive(dl)) {
-                sprintf(buf, "%dhp", dl->hp);
-                write_text(&wtr, dl->pos.x, dl->pos.y + t, buf, Color_Red);
-            }
+    /* every bucket under the view, widened by how far an ent can draw from its pos.
+     * zoomed out far enough for that to wrap around, it's just all of them */
+    EntGrid *grid = ent_grid(w);
+    Vec2 half = view_half_size();
+    int x0 = ent_grid_cell(state.cam.x - half.x - grid->reach),
+        x1 = ent_grid_cell(state.cam.x + half.x + grid->reach),
+        y0 = ent_grid_cell(state.cam.y - half.y - grid->reach),
+        y1 = ent_grid_cell(state.cam.y + half.y + grid->reach);
+    int nx = x1 - x0 + 1, ny = y1 - y0 + 1;
+    int all = (int64_t)nx * ny >= ENT_GRID_BUCKETS;
+    uint64_t seen[ENT_GRID_BUCKETS / 64] = {0};
+    int drawn = 0;
+    for (int c = 0; c < (all ? ENT_GRID_BUCKETS : nx * ny); c++) {
+        int b = all ? c : ent_grid_bucket(x0 + c % nx, y0 + c / nx);
+        if (seen[b / 64] & (1ull << (b % 64))) continue;
+        seen[b / 64] |= 1ull << (b % 64);
+
+        for (int i = grid->start[b]; i < grid->start[b + 1]; i++) {
+            Ent *e = w->ents + grid->ents[i];
+            if (view_overlaps(half, e->pos, grid->reaches[i]))
+                write_ent(wtr, w, e), drawn++;
+        }
+    }
+    TRACE_COUNTER("ents", "live", grid->start[ENT_GRID_BUCKETS], "drawn", drawn);
+    TRACE_COUNTER("projs", "live", w->nproj, NULL, 0);
+
+    for (Proj *p = w->projs; (p - w->projs) < w->nproj; p++)
+        if (view_overlaps(half, p->pos, ARROW_TIP))
+            write_arrow(wtr, vec2_rads(p->vel), p->pos.x, p->pos.y, p->pos.y);
+    TRACE_END("write_world");
+}
+
+/* text and ui, in screen space */
+static void write_hud(GeoWtr *wtr, World *w) {
+    TRACE_BEGIN("write_hud");
+    wtr->scale = 1.0f;
+    char buf[1 << 6];
+    sprintf(buf, "%d FPS", (int)roundf(1.0f / sapp_frame_duration()));
+    write_text(wtr, sapp_widthf() - 90.0f, sapp_heightf(), buf, Color_White);
+
+    write_ui(wtr);
+
+    int nlbl = 0;
+    for (int i = 0; i < sizeof(w->dmg_lbls) / sizeof(w->dmg_lbls[0]); i++) {
+        DmgLbl *dl = w->dmg_lbls + i;
+        float t = w->tick - dl->tick;
+        if (dmg_lbl_alive(dl)) {
+            Vec2 pos = world_to_screen(dl->pos);
+            sprintf(buf, "%dhp", dl->hp);
+            write_text(wtr, pos.x, pos.y + t, buf, Color_Red);
+            nlbl++;
         }
     }
+    TRACE_COUNTER("dmg labels", "alive", nlbl, NULL, 0);
+    TRACE_END("write_hud");
+}
+
+static void frame_loading(void) {
+    stm_laptime(&state.frame); /* so the first frame in play doesn't owe ticks */
+
+    GeoWtr wtr = geo_wtr(&state.dyn_geo);
+    write_loading(&wtr);
+    geo_wtr_flush(&wtr);
+
+    sg_begin_default_pass(&state.pass_action, sapp_width(), sapp_height());
+    sg_apply_pipeline(state.pip);
+    sg_apply_uniforms(SG_SHADERSTAGE_VS, SLOT_vs_params, &SG_RANGE(((vs_params_t) {
+        .mvp = ortho4x4(0.0f, sapp_widthf(), 0.0f, sapp_heightf(), -1.0f, 1.0f),
+    })));
+    sg_apply_bindings(&state.dyn_geo.bind);
+    sg_draw(0, wtr.idx - state.dyn_geo.idxs, 1);
+    sg_end_pass();
+    sg_commit();
+
+    if (!load.first_frame) load.first_frame = stm_since(load.start);
+    state.input.ui.n = state.input.game.n = 0; /* none of it is going to show */
+}
+
+/* an opaque draw out of one buffer pair, ordered by its nearest z */
+typedef struct {
+    float front_z;
+    sg_buffer vbuf, ibuf;
+    int first, nidx;
+} DrawBatch;
+static int draw_batch_cmp(const void *a, const void *b) {
+    const DrawBatch *l = a, *r = b;
+    return (l->front_z > r->front_z) - (l->front_z < r->front_z);
+}
+
+static void frame(void) {
+    TRACE_BEGIN("frame");
+    arena_reset(mem + Mem_Frame);
+    if (!load_poll()) {
+        frame_loading();
+        TRACE_END("frame");
+        if (TRACING) trace_drain();
+        return;
+    }
+    map_watch();
+
+    double elapsed = stm_ms(stm_laptime(&state.frame));
+    state.fixed_tick_accumulator += elapsed;
+    /* late sampling: rather than wait on the accumulator, game input that came in
+     * since the last tick gets one this frame. that's borrowed from the next
+     * frame's ticks, and never more than one of them */
+    int pull = state.input.late && state.input.game.n && state.fixed_tick_accumulator > 0.0,
+        ticked = 0;
+    while (state.fixed_tick_accumulator > TICK_MS || pull) {
+        pull = 0, ticked = 1;
+        state.fixed_tick_accumulator -= TICK_MS;
+        world_input_from_keys(state.world);
+        tick(state.world);
+        state.cam = lerp2(state.cam, add2(state.world->player->pos, vec2(0.0f, 0.5f)), 0.05f);
+    }
 
+    GeoWtr wtr = geo_wtr(&state.dyn_geo); 
+    write_world(&wtr, state.world);
+    uint16_t *text_start = wtr.idx;
+    Vert *text_vert = wtr.vert;
+    write_hud(&wtr, state.world);
     geo_wtr_flush(&wtr);
+    glyphs_flush(mem + Mem_Frame);
+
+    GeoWtr part_wtr = geo_wtr(&state.part_geo);
+    write_parts(&part_wtr, state.parts);
+    size_t part_nidx = part_wtr.idx - state.part_geo.idxs;
+    if (part_nidx) geo_wtr_flush(&part_wtr);
+
+    /* the opaque world, nearest batch first, so what's behind fails the depth
+     * test instead of being shaded over */
+    MapLod lod = map_lod_pick();
+    DrawBatch *batches = ARENA_ARRAY(mem + Mem_Frame, DrawBatch, state.nchunk + 2);
+    int nbatch = 0;
+    for (MapChunk *c = state.chunks; (c - state.chunks) < state.nchunk; c++)
+        if (c->lod_nidx[lod] && map_chunk_visible(c))
+            batches[nbatch++] = (DrawBatch) {
+                c->front_z, c->vbuf, c->ibuf, c->lod_first[lod], c->lod_nidx[lod]
+            };
+    if (text_start > state.dyn_geo.idxs)
+        batches[nbatch++] = (DrawBatch) {
+            geo_front_z(state.dyn_geo.verts, text_vert),
+            state.dyn_geo.bind.vertex_buffers[0], state.dyn_geo.bind.index_buffer,
+            0, text_start - state.dyn_geo.idxs
+        };
+    if (part_nidx)
+        batches[nbatch++] = (DrawBatch) {
+            geo_front_z(state.part_geo.verts, part_wtr.vert),
+            state.part_geo.bind.vertex_buffers[0], state.part_geo.bind.index_buffer,
+            0, part_nidx
+        };
+    qsort(batches, nbatch, sizeof(DrawBatch), draw_batch_cmp);
 
     sg_begin_default_pass(&state.pass_action, sapp_width(), sapp_height());
     sg_apply_pipeline(state.pip);
 
     geo_find_z_range(state.dyn_geo.verts, wtr.vert);
+    geo_find_z_range(state.part_geo.verts, part_wtr.vert);
     vs_params_t vs_params = { .mvp = mvp4x4() };
     sg_apply_uniforms(SG_SHADERSTAGE_VS, SLOT_vs_params, &SG_RANGE(vs_params));
 
-    sg_apply_bindings(&state.static_geo.bind);
-    sg_draw(0, state.static_geo_n_idx, 1);
+    for (DrawBatch *b = batches; (b - batches) < nbatch; b++) {
+        sg_bindings bind = state.dyn_geo.bind;
+        bind.vertex_buffers[0] = b->vbuf;
+        bind.index_buffer = b->ibuf;
+        sg_apply_bindings(&bind);
+        sg_draw(b->first, b->nidx, 1);
+    }
 
+    sg_apply_pipeline(state.blend_pip);
     sg_apply_bindings(&state.dyn_geo.bind);
-    sg_draw(0, text_start - state.dyn_geo.idxs, 1);
-
     sg_apply_uniforms(SG_SHADERSTAGE_VS, SLOT_vs_params, &SG_RANGE(((vs_params_t) {
         .mvp = ortho4x4(0.0f, sapp_widthf(), 0.0f, sapp_heightf(), -1.0f, 1.0f),
     })));
@@ -1589,9 +4431,18 @@ static void frame(void) {
 
     sg_end_pass();
     sg_commit();
+
+    uint64_t now = stm_now();
+    input_shown(&state.input.ui, now);
+    if (ticked) input_shown(&state.input.game, now);
+    TRACE_END("frame");
+    if (TRACING) trace_drain();
 }
 
 static void cleanup(void) {
+    if (glyphs.ttf) file_unmap(glyphs.ttf, glyphs.ttf_size);
+    latency_report();
+    trace_stop();
     sg_shutdown();
 }
 
@@ -0,0 +1,100 @@
+import json
+import os
+import struct
+
+# compiles meshes.json (from blender_export_mesh.py) into build/meshes.bytes,
+# which the game loads at startup. each mesh has its duplicate verts welded,
+# its triangles reordered for the post-transform vertex cache, and its verts
+# reordered by first use so they're fetched in order.
+#
+# the meshes are flat and drawn at one z, so where triangles overlap they're
+# shaded twice whatever order they're in; there's no overdraw order to pick.
+#
+# keep MESH_VERSION and the layout in sync with load_meshes() in main.c
+
+MESH_VERSION = 1
+NAME_LEN = 16
+CACHE_SIZE = 32  # about what a gpu's post-transform cache holds
+
+def weld(verts, tris):
+    """merges verts that land on the same spot, and drops unused ones"""
+    remap, welded, seen = {}, [], {}
+    for t in tris:
+        for v in t:
+            if v in remap: continue
+            key = tuple(round(c, 4) for c in verts[v])
+            if key not in seen:
+                seen[key] = len(welded)
+                welded.append(verts[v])
+            remap[v] = seen[key]
+    return welded, [[remap[v] for v in t] for t in tris]
+
+def acmr(tris):
+    """verts transformed per triangle through an lru cache of CACHE_SIZE"""
+    cache, misses = [], 0
+    for t in tris:
+        for v in t:
+            if v in cache: cache.remove(v)
+            else: misses += 1
+            cache.insert(0, v)
+        del cache[CACHE_SIZE:]
+    return misses / max(len(tris), 1)
+
+def forsyth(nvert, tris):
+    """tom forsyth's linear-speed vertex cache optimisation: greedily emits the
+    triangle whose verts score best, favouring ones that are in the cache and
+    ones with few triangles left, so lonely verts don't get stranded"""
+    def score(v):
+        if not live[v]: return -1.0
+        s = 0.0
+        if v in cache:
+            pos = cache.index(v)
+            s = 0.75 if pos < 3 else (1.0 - (pos - 3) / (CACHE_SIZE - 3)) ** 1.5
+        return s + 2.0 * live[v] ** -0.5
+
+    live = [0] * nvert
+    for t in tris:
+        for v in t: live[v] += 1
+
+    cache, out, left = [], [], list(range(len(tris)))
+    while left:
+        # the meshes are tens of triangles, so every one is rescored each step
+        best = max(left, key=lambda i: sum(score(v) for v in tris[i]))
+        left.remove(best)
+        out.append(tris[best])
+        for v in tris[best]:
+            live[v] -= 1
+            if v in cache: cache.remove(v)
+            cache.insert(0, v)
+        del cache[CACHE_SIZE:]
+    return out
+
+def by_first_use(verts, tris):
+    order = {}
+    for t in tris:
+        for v in t: order.setdefault(v, len(order))
+    out = [None] * len(order)
+    for v, i in order.items(): out[i] = verts[v]
+    return out, [[order[v] for v in t] for t in tris]
+
+with open('meshes.json') as f:
+    meshes = json.load(f)
+
+out = bytearray(struct.pack('<4sII', b'MESH', MESH_VERSION, len(meshes)))
+for name, m in meshes.items():
+    if len(name) >= NAME_LEN: exit(f"{name}: names are at most {NAME_LEN - 1} characters")
+    verts, tris = weld(m['verts'], m['tris'])
+    before = acmr(tris)
+    tris = forsyth(len(verts), tris)
+    verts, tris = by_first_use(verts, tris)
+    print(f"{name}: {len(m['verts'])} -> {len(verts)} verts, {len(tris)} triangles, acmr {before:.2f} -> {acmr(tris):.2f}")
+
+    idxs = [v for t in tris for v in t]
+    out += struct.pack(f'<{NAME_LEN}sII', name.encode(), len(verts), len(idxs))
+    for v in verts: out += struct.pack('<2f', *v)
+    out += struct.pack(f'<{len(idxs)}H', *idxs)
+    while len(out) % 4: out += b'\0'
+
+os.makedirs('build', exist_ok=True)
+with open('build/meshes.bytes', 'wb') as f:
+    f.write(out)
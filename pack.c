@@ -0,0 +1,80 @@
+/* offline asset bake: writes the palette and the map's chunk meshes
+ * into build/assets.pack, which init() maps and uploads without baking anything.
+ *
+ * ./bake.sh builds and runs this after the game; run it from the repo root */
+#define HEADLESS
+
+#include "main.c"
+
+static void pack_align(FILE *f) {
+    while (ftell(f) % ASSET_PACK_ALIGN) fputc(0, f);
+}
+
+int main(int argc, char **argv) {
+    const char *path = (argc > 1) ? argv[1] : ASSET_PACK_PATH;
+
+    mem_init();
+    FILE *map_file = fopen(MAP_PATH, "rb");
+    if (!map_file) perror("couldn't open map"), exit(1);
+    state.level.map = parse_map_data(map_file, mem + Mem_Map);
+    fclose(map_file);
+    map_sort(&state.level.map);
+
+    static AssetPackTex tex;
+    palette_bake(tex.palette);
+
+    for (MapData_Tree *t = state.level.map.trees; (t - state.level.map.trees) < state.level.map.ntrees; t++)
+        map_chunk_of(t);
+
+    AssetPackHeader head = {
+        .magic = "APAK",
+        .version = ASSET_PACK_VERSION,
+        .map_hash = map_trees_hash(&state.level.map),
+        .nchunk = state.nchunk,
+    };
+    static AssetPackChunk table[MAP_CHUNK_MAX];
+
+    FILE *f = fopen(path, "wb");
+    if (!f) perror("couldn't write asset pack"), exit(1);
+
+    /* the header and table are rewritten once the offsets are known */
+    fwrite(&head, sizeof(head), 1, f);
+    fwrite(&tex, sizeof(tex), 1, f);
+    fwrite(table, sizeof(AssetPackChunk), state.nchunk, f);
+
+    state.static_geo = geo_alloc(mem + Mem_StaticGeo, STATIC_GEO_NVERT, STATIC_GEO_NIDX);
+    for (int i = 0; i < state.nchunk; i++) {
+        MapChunk *c = state.chunks + i;
+        GeoWtr wtr = geo_wtr(&state.static_geo);
+        map_chunk_write(&wtr, c);
+        geo_find_z_range(state.static_geo.verts, wtr.vert);
+
+        table[i] = (AssetPackChunk) {
+            .x = c->x,
+            .y = c->y,
+            .nvert = wtr.vert - state.static_geo.verts,
+            .nidx = wtr.idx - state.static_geo.idxs,
+        };
+        for (MapLod lod = 0; lod < MapLod_COUNT; lod++)
+            table[i].lod_first[lod] = c->lod_first[lod],
+            table[i].lod_nidx[lod] = c->lod_nidx[lod];
+        pack_align(f);
+        table[i].vert_offset = ftell(f);
+        fwrite(state.static_geo.verts, sizeof(Vert), table[i].nvert, f);
+        pack_align(f);
+        table[i].idx_offset = ftell(f);
+        fwrite(state.static_geo.idxs, sizeof(uint16_t), table[i].nidx, f);
+    }
+
+    head.min_z = geo_min_z;
+    head.max_z = geo_max_z;
+    head.size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    fwrite(&head, sizeof(head), 1, f);
+    fseek(f, sizeof(head) + sizeof(tex), SEEK_SET);
+    fwrite(table, sizeof(AssetPackChunk), state.nchunk, f);
+    if (fclose(f)) perror("couldn't write asset pack"), exit(1);
+
+    printf("packed %d chunks into %s, %u bytes\n", state.nchunk, path, head.size);
+    return 0;
+}
@@ -0,0 +1,77 @@
+import math
+import random
+import struct
+import sys
+
+# checks build/terrain.sdf (baked by the game at load) against the analytic
+# distance to the circles in build/map.bytes
+
+SLACK = 0.01 # keep in sync with TERRAIN_SDF_SLACK in main.c
+
+def read_circles(path):
+    with open(path, 'rb') as f:
+        data = f.read()
+    at = 0
+    (ntrees,) = struct.unpack_from('!L', data, at)
+    at += 4 + ntrees * 2 * 4
+    (ncircles,) = struct.unpack_from('!L', data, at)
+    at += 4
+    return [struct.unpack_from('fff', data, at + i * 12) for i in range(ncircles)]
+
+def read_sdf(path):
+    with open(path, 'rb') as f:
+        data = f.read()
+    head = '4sIIfffii'
+    magic, version, map_hash, ox, oy, cell, w, h = struct.unpack_from(head, data)
+    if magic != b'TSDF':
+        sys.exit(f"{path} isn't a terrain sdf")
+    dist = struct.unpack_from(f'{w * h}f', data, struct.calcsize(head))
+    return { 'version': version, 'ox': ox, 'oy': oy, 'cell': cell, 'w': w, 'h': h, 'dist': dist }
+
+def analytic(circles, x, y):
+    return min(math.hypot(x - cx, y - cy) - r for cx, cy, r in circles)
+
+def sample(sdf, x, y):
+    fx = (x - sdf['ox']) / sdf['cell']
+    fy = (y - sdf['oy']) / sdf['cell']
+    ix, iy = int(fx), int(fy)
+    tx, ty = fx - ix, fy - iy
+    w, d = sdf['w'], sdf['dist']
+    i = iy * w + ix
+    bot = d[i]     + (d[i + 1]     - d[i])     * tx
+    top = d[i + w] + (d[i + w + 1] - d[i + w]) * tx
+    return bot + (top - bot) * ty
+
+circles = read_circles(sys.argv[1] if len(sys.argv) > 1 else 'build/map.bytes')
+sdf = read_sdf(sys.argv[2] if len(sys.argv) > 2 else 'build/terrain.sdf')
+nsamples = int(sys.argv[3]) if len(sys.argv) > 3 else 100000
+
+node_err = 0.0
+for y in range(sdf['h']):
+    for x in range(sdf['w']):
+        px, py = sdf['ox'] + x * sdf['cell'], sdf['oy'] + y * sdf['cell']
+        node_err = max(node_err, abs(sdf['dist'][y * sdf['w'] + x] - analytic(circles, px, py)))
+
+random.seed(0)
+abs_sum, abs_max, over_max, near_over_max = 0.0, 0.0, 0.0, 0.0
+for _ in range(nsamples):
+    x = sdf['ox'] + random.random() * (sdf['w'] - 1) * sdf['cell']
+    y = sdf['oy'] + random.random() * (sdf['h'] - 1) * sdf['cell']
+    want = analytic(circles, x, y)
+    got = sample(sdf, x, y) - SLACK
+    err = got - want
+    abs_sum += abs(err)
+    abs_max = max(abs_max, abs(err))
+    if want >= 0.0:
+        over_max = max(over_max, err)
+    if 0.0 <= want < 0.5:
+        near_over_max = max(near_over_max, err)
+
+print(f"{sdf['w']}x{sdf['h']} samples, {sdf['cell']} apart, {len(circles)} circles")
+print(f"grid nodes:   max |error| {node_err:.6f}")
+print(f"bilinear:     mean |error| {abs_sum / nsamples:.6f}, max |error| {abs_max:.6f}")
+print(f"overestimate outside terrain: max {over_max:.6f}, within 0.5 of a surface {near_over_max:.6f}")
+
+# sphere tracing can step through a surface if the sdf says it's farther than it is
+# (inside the terrain it doesn't matter, anything there is already colliding)
+sys.exit(1 if over_max > 0.0 else 0)